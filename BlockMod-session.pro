@@ -6,11 +6,17 @@ TEMPLATE=subdirs
 SUBDIRS += BlockMod \
 	BlockModDemo \
 	SerializationTest \
-	ShowNetworkTest
+	ShowNetworkTest \
+	BlockModBench \
+	ParallelReadTest
 
 SerializationTest.file = BlockModTests/SerializationTest.pro
 ShowNetworkTest.file = BlockModTests/ShowNetworkTest.pro
+BlockModBench.file = BlockModTests/BlockModBench.pro
+ParallelReadTest.file = BlockModTests/ParallelReadTest.pro
 
 BlockModDemo.depends = BlockMod
 SerializationTest.depends = BlockMod
 ShowNetworkTest.depends = BlockMod
+BlockModBench.depends = BlockMod
+ParallelReadTest.depends = BlockMod
@@ -8,7 +8,7 @@ TEMPLATE = lib
 # common project configurations, source this file after TEMPLATE was specified
 include( BlockMod.pri )
 
-QT += core gui network xml widgets
+QT += core gui network xml widgets concurrent
 
 # finally we setup our custom library specfic things
 # like version number etc.
@@ -24,6 +24,7 @@ INCLUDEPATH = \
 
 HEADERS += \
 	src/BM_ConnectorSegmentItem.h \
+	src/BM_ConnectorPathItem.h \
 	src/BM_Globals.h \
 	src/BM_SocketItem.h \
 	src/BM_ZoomMeshGraphicsView.h \
@@ -31,20 +32,32 @@ HEADERS += \
 	src/BM_Connector.h \
 	src/BM_Socket.h \
 	src/BM_Network.h \
+	src/BM_NetworkLoader.h \
+	src/BM_NetworkChangeSet.h \
+	src/BM_NetworkSnapshot.h \
 	src/BM_XMLHelpers.h \
 	src/BM_SceneManager.h \
+	src/BM_SlotMap.h \
+	src/BM_SpatialGrid.h \
+	src/BM_BinaryFormat.h \
+	src/BM_UndoStep.h \
 	src/BM_BlockItem.h
 SOURCES += \
 	src/BM_ConnectorSegmentItem.cpp \
+	src/BM_ConnectorPathItem.cpp \
 	src/BM_Globals.cpp \
 	src/BM_SocketItem.cpp \
 	src/BM_ZoomMeshGraphicsView.cpp \
 	src/BM_Network.cpp \
+	src/BM_NetworkLoader.cpp \
+	src/BM_NetworkChangeSet.cpp \
+	src/BM_NetworkSnapshot.cpp \
 	src/BM_Block.cpp \
 	src/BM_Socket.cpp \
 	src/BM_XMLHelpers.cpp \
 	src/BM_Connector.cpp \
 	src/BM_SceneManager.cpp \
+	src/BM_UndoStep.cpp \
 	src/BM_BlockItem.cpp
 FORMS +=
 
@@ -0,0 +1,169 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_BinaryFormatH
+#define BM_BinaryFormatH
+
+#include <QtGlobal>
+
+namespace BLOCKMOD {
+
+/*! Record definitions of the compact binary network format (*.bmb).
+
+	The binary format is meant for fast loading and saving of large networks. It is written
+	in the byte order of the writing machine and only read back on machines with the same byte order.
+	The XML format (*.bm) remains the interchange format.
+
+	File layout (all sections start at 8-byte aligned offsets):
+	- FileHeader
+	- string offset table: quint32[stringCount+1], start of each string in string data (in UTF-16 code units)
+	- string data: UTF-16 code units of all strings (each distinct string is stored only once)
+	- BlockRecord[blockCount]
+	- SocketRecord[socketCount], sockets of all blocks, blocks reference a consecutive range
+	- PropertyRecord[propertyCount], properties of all blocks, blocks reference a consecutive range
+	- ConnectorRecord[connectorCount]
+	- SegmentRecord[segmentCount], segments of all connectors, connectors reference a consecutive range
+
+	All strings are referenced by their index in the string table. Connectors reference sockets
+	by block index and socket index, so no name lookup is needed when reading the network.
+*/
+namespace BinaryFormat {
+
+/*! Magic number at file begin, reads 'BMB' followed by a zero byte when written little endian. */
+const quint32 MAGIC = 0x00424D42;
+/*! Written as byte order marker, reads differently when opened on a machine with different byte order. */
+const quint32 BYTE_ORDER_MARK = 0x01020304;
+/*! Current version of the format. */
+const quint32 VERSION = 1;
+
+/*! File header with section sizes and offsets (relative to file begin). */
+struct FileHeader {
+	quint32		m_magic;
+	quint32		m_byteOrderMark;
+	quint32		m_version;
+	quint32		m_stringCount;
+	quint32		m_blockCount;
+	quint32		m_socketCount;
+	quint32		m_propertyCount;
+	quint32		m_connectorCount;
+	quint32		m_segmentCount;
+	quint32		m_reserved;
+	quint64		m_stringTableOffset;
+	quint64		m_stringDataOffset;
+	quint64		m_blockOffset;
+	quint64		m_socketOffset;
+	quint64		m_propertyOffset;
+	quint64		m_connectorOffset;
+	quint64		m_segmentOffset;
+	/*! Total size of file, used to detect truncated files. */
+	quint64		m_fileSize;
+};
+
+/*! Flags of a block record. */
+enum BlockFlags {
+	BF_ConnectionHelperBlock = 0x1
+};
+
+/*! A block with references to its range of sockets and properties. */
+struct BlockRecord {
+	quint32		m_name;
+	quint32		m_flags;
+	quint32		m_firstSocket;
+	quint32		m_socketCount;
+	quint32		m_firstProperty;
+	quint32		m_propertyCount;
+	double		m_x;
+	double		m_y;
+	double		m_width;
+	double		m_height;
+};
+
+/*! Flags of a socket record. */
+enum SocketFlags {
+	SF_Inlet	= 0x1,
+	SF_Vertical	= 0x2
+};
+
+/*! A socket, position relative to parent block. */
+struct SocketRecord {
+	quint32		m_name;
+	quint32		m_flags;
+	double		m_x;
+	double		m_y;
+};
+
+/*! A custom block property, value is stored as string and converted back to type m_type (a QMetaType id). */
+struct PropertyRecord {
+	quint32		m_key;
+	quint32		m_value;
+	qint32		m_type;
+	quint32		m_reserved;
+};
+
+/*! Flags of a connector record. */
+enum ConnectorFlags {
+	/*! If set, m_sourceBlock is the string index of the flat source socket name (connector could not be resolved). */
+	CF_SourceFlatName	= 0x1,
+	/*! If set, m_targetBlock is the string index of the flat target socket name (connector could not be resolved). */
+	CF_TargetFlatName	= 0x2
+};
+
+/*! A connector with references to source and target sockets and its range of segments. */
+struct ConnectorRecord {
+	quint32		m_name;
+	quint32		m_flags;
+	quint32		m_sourceBlock;
+	quint32		m_sourceSocket;
+	quint32		m_targetBlock;
+	quint32		m_targetSocket;
+	quint32		m_text;
+	quint32		m_color;
+	quint32		m_firstSegment;
+	quint32		m_segmentCount;
+	double		m_linewidth;
+};
+
+/*! A connector segment. */
+struct SegmentRecord {
+	/*! Orientation of the segment, 1 = horizontal, 2 = vertical (Qt::Orientation). */
+	quint32		m_direction;
+	quint32		m_reserved;
+	double		m_offset;
+};
+
+} // namespace BinaryFormat
+
+} // namespace BLOCKMOD
+
+
+#endif // BM_BinaryFormatH
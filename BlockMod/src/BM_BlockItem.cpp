@@ -38,6 +38,7 @@
 
 #include <QPainter>
 #include <QLinearGradient>
+#include <QFontMetrics>
 #include <QStyleOptionGraphicsItem>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsScene>
@@ -52,7 +53,8 @@ namespace BLOCKMOD {
 
 BlockItem::BlockItem(Block * b) :
 	QGraphicsRectItem(),
-	m_block(b)
+	m_block(b),
+	m_nameLineSpacing(0)
 {
 	setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemSendsGeometryChanges);
 	setZValue(10);
@@ -61,6 +63,29 @@ BlockItem::BlockItem(Block * b) :
 }
 
 
+void BlockItem::setBlock(Block * b) {
+	Q_ASSERT(scene() == nullptr);
+	m_block = b;
+	m_moved = false;
+	setSelected(false);
+
+	// re-use socket items, remove superfluous and create missing ones
+	while (m_socketItems.count() > b->m_sockets.count())
+		delete m_socketItems.takeLast();
+	for (int i=0; i<b->m_sockets.count(); ++i) {
+		Socket & s = b->m_sockets[i];
+		if (i < m_socketItems.count())
+			m_socketItems[i]->setSocket(&s);
+		else
+			m_socketItems.append(new SocketItem(this, &s));
+		m_socketItems[i]->setZValue(s.m_inlet ? 12 : 20); // outlet nodes are drawn over lines
+	}
+
+	setRect(0, 0, b->m_size.width(), b->m_size.height());
+	setPos(b->m_pos);
+}
+
+
 SocketItem * BlockItem::inletSocketAcceptingConnection(const QPointF & scenePos) {
 	for (SocketItem * si : m_socketItems) {
 		QPointF socketScenePos = si->mapToScene(si->socket()->m_pos);
@@ -112,7 +137,8 @@ void BlockItem::resize(int newWidth, int newHeight) {
 
 
 QRectF BlockItem::boundingRect() const {
-	QRectF r = QGraphicsRectItem::boundingRect();
+	// selected blocks are drawn with a 1.5 pixel wide outline
+	QRectF r = rect().adjusted(-1, -1, 1, 1);
 	/// \todo Later, if we draw text annotations outside the rectangle, adjust the bounding rect here
 	return r;
 }
@@ -142,8 +168,25 @@ void BlockItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * optio
 	// special handling for invisible blocks
 	if (isInvisible())
 		return; // nothing to be drawn
+	// level of detail depends on zoom level
+	const double lod = option->levelOfDetailFromTransform(painter->worldTransform());
 	painter->save();
+	if (lod < Globals::DetailLevelOfDetail) {
+		// zoomed out: flat fill with cosmetic outline, no pixmap, gradient or label
+		painter->setPen(QPen((option->state & QStyle::State_Selected) ? QColor(0,128,0) : QColor(Qt::black), 0));
+		if (m_block->m_properties.contains("ShowPixmap") && m_block->m_properties["ShowPixmap"].toBool())
+			painter->setBrush(Qt::white);
+		else if (option->state & QStyle::State_Selected)
+			painter->setBrush(QColor(215,248,205));
+		else
+			painter->setBrush(QColor(208,208,255));
+		painter->drawRect(rect());
+		painter->restore();
+		return;
+	}
 	painter->setRenderHint(QPainter::Antialiasing, true);
+	const bool drawLabel = lod >= Globals::LabelLevelOfDetail;
+	updateNameText(painter->font());
 	if (m_block->m_properties.contains("ShowPixmap") &&
 		m_block->m_properties["ShowPixmap"].toBool() &&
 		m_block->m_properties.contains("Pixmap"))
@@ -154,17 +197,15 @@ void BlockItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * optio
 		painter->fillRect(r, QBrush(Qt::white));
 
 		// adjust area for pixmap
-		QFontMetrics fm(painter->font());
-		r.setTop(r.top()+4+fm.lineSpacing());
+		r.setTop(r.top()+4+m_nameLineSpacing);
 		QPixmap p = m_block->m_properties["Pixmap"].value<QPixmap>();
 		painter->drawPixmap(r, p, p.rect());
 		painter->setPen( Qt::black );
 		painter->setBrush(Qt::NoBrush);
 		painter->drawRect(rect());
 		// now draw the label of the block
-		r = rect();
-		r.moveTop(4);
-		painter->drawText(r, Qt::AlignTop | Qt::AlignHCenter, m_block->m_name);
+		if (drawLabel)
+			drawNameText(painter);
 	}
 	else {
 		QLinearGradient grad(QPointF(0,0), QPointF(rect().width(),0));
@@ -182,9 +223,8 @@ void BlockItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * optio
 		painter->setPen( Qt::black );
 		painter->drawRect(rect());
 		// now draw the label of the block
-		QRectF r = rect();
-		r.moveTop(4);
-		painter->drawText(r, Qt::AlignTop | Qt::AlignHCenter, m_block->m_name);
+		if (drawLabel)
+			drawNameText(painter);
 	}
 	painter->restore();
 }
@@ -254,4 +294,33 @@ void BlockItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
 	QGraphicsRectItem::mouseDoubleClickEvent(event);
 }
 
+// *** private functions ***
+
+void BlockItem::updateNameText(const QFont & font) {
+	if (m_nameText.text() == m_block->m_name && m_nameFont == font && m_nameLineSpacing != 0)
+		return;
+	m_nameText.setTextFormat(Qt::PlainText);
+	m_nameText.setText(m_block->m_name);
+	m_nameText.prepare(QTransform(), font);
+	m_nameFont = font;
+	m_nameLineSpacing = QFontMetricsF(font).lineSpacing();
+}
+
+
+void BlockItem::drawNameText(QPainter * painter) {
+	QRectF r = rect();
+	r.moveTop(4);
+	double textWidth = m_nameText.size().width();
+	// names wider than the block are clipped (rare case, so we only pay for clipping if needed)
+	bool clip = textWidth > r.width();
+	if (clip) {
+		painter->save();
+		painter->setClipRect(r, Qt::IntersectClip);
+	}
+	painter->drawStaticText(QPointF(r.left() + 0.5*(r.width() - textWidth), r.top()), m_nameText);
+	if (clip)
+		painter->restore();
+}
+
+
 } // namespace BLOCKMOD
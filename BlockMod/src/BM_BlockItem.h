@@ -35,6 +35,8 @@
 #define BM_BlockItemH
 
 #include <QGraphicsRectItem>
+#include <QStaticText>
+#include <QFont>
 
 namespace BLOCKMOD {
 
@@ -51,6 +53,13 @@ public:
 
 	const Block * block() const { return m_block; }
 
+	/*! Associates the item with another block, used by the scene manager to recycle block items
+		in virtualized mode. Existing socket items are re-used, missing ones are created.
+		Must only be called while the item is not part of a scene.
+		Re-implement this function if your derived item keeps additional block-specific state.
+	*/
+	virtual void setBlock(Block * b);
+
 	/*! Searches for a socket item at the given scene position and returns a pointer to it, if
 		it is not yet connected.
 	*/
@@ -86,6 +95,12 @@ protected:
 
 
 private:
+	/*! Lays out the block name again, if name or font have changed since the last call. */
+	void updateNameText(const QFont & font);
+
+	/*! Draws the block name centered at the top of the block, using the cached static text. */
+	void drawNameText(QPainter * painter);
+
 	/*! Pointer to associated block. */
 	Block				*m_block;
 
@@ -95,6 +110,13 @@ private:
 	/*! Our socket items, childs of this block item. */
 	QList<SocketItem*>	m_socketItems;
 
+	/*! The block name, laid out once and re-used in every paint() call. */
+	QStaticText			m_nameText;
+	/*! Font that m_nameText was laid out with. */
+	QFont				m_nameFont;
+	/*! Line spacing of m_nameFont. */
+	double				m_nameLineSpacing;
+
 	friend class SceneManager;
 };
 
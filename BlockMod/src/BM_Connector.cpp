@@ -38,6 +38,7 @@
 #include <QDebug>
 
 #include "BM_XMLHelpers.h"
+#include "BM_Globals.h"
 
 namespace BLOCKMOD {
 
@@ -75,12 +76,154 @@ void Connector::readXML(QXmlStreamReader & reader) {
 
 
 void Connector::writeXML(QXmlStreamWriter & writer) const {
+	writeXML(writer, m_sourceSocket, m_targetSocket);
+}
+
+
+int Connector::moveSegment(int segIdx, double dx, double dy) {
+	// we must distribute the dx and dy to both sides of the moved connector
+	// modifying the offsets in connector segments with lower index will move the currently
+	// selected segment accordingly.
+
+	// For example: Suppose the mouse was moved by 8 pixels to the right.
+	//              a) the start position is to the left, then we need to reduce the offset of the
+	//                 first horizontal segments before the current segment by 8 pixels.
+	//              b) the start position is to the right, then the distance is reduced.
+	// Algorithm:
+	// - process all segments to the left of the connector and distribute dx and dy
+	// - if afterwards dx and dy is still != 0, check if this segment can be extended to compensate
+	// - if not (different direction), insert a new line segment left of this position with the matching direction and offset
+
+	// Source/Start-direction
+	Q_ASSERT(segIdx >= 0 && segIdx < m_segments.size());
+	const double moveX = dx;
+	const double moveY = dy;
+	int currentIdx = segIdx;
+
+	while ((--segIdx >= 0) && (!Globals::nearZero(dx) || !Globals::nearZero(dy)) ) {
+		// get next segment to the left
+		Segment & seg = m_segments[segIdx];
+		if (!Globals::nearZero(dx)) {
+			if (seg.m_direction == Qt::Horizontal) {
+				seg.m_offset += dx;
+				dx = 0;
+			}
+		}
+		if (!Globals::nearZero(dy)) {
+			if (seg.m_direction == Qt::Vertical) {
+				seg.m_offset += dy;
+				dy = 0;
+			}
+		}
+	}
+
+	// reset segment index for currently selected segment
+	segIdx = currentIdx;
+
+	// we may have dx or dy left, in this case insert a new segment before the current to compensate the distance
+	if (!Globals::nearZero(dx)) {
+		// check, if we can extend the currently selected segment
+		Segment & seg = m_segments[segIdx];
+		if (seg.m_direction == Qt::Horizontal) {
+			seg.m_offset += dx;
+		}
+		else {
+			Segment newSeg;
+			newSeg.m_direction = Qt::Horizontal;
+			newSeg.m_offset = dx;
+			dx = 0;
+			// always insert as first element - since we checked for the presence of horizontal
+			// segments above, and we know there are none - we can savely assume
+			// that we have no horizontal segment at the begin
+			m_segments.insert(0, newSeg);
+			++segIdx; // mind, our own segment index has shifted
+			currentIdx = segIdx;
+		}
+	}
+
+	if (!Globals::nearZero(dy)) {
+		Segment & seg = m_segments[segIdx];
+		if (seg.m_direction == Qt::Vertical) {
+			seg.m_offset += dy;
+		}
+		else {
+			Segment newSeg;
+			newSeg.m_direction = Qt::Vertical;
+			newSeg.m_offset = dy;
+			dy = 0;
+			m_segments.insert(0, newSeg);
+			++segIdx; // mind, our own segment index has shifted
+			currentIdx = segIdx;
+		}
+	}
+
+	// same for the connectors towards the end
+	dx = moveX;
+	dy = moveY;
+
+	while (++segIdx < m_segments.count() && (!Globals::nearZero(dx) || !Globals::nearZero(dy)) ) {
+		// get next segment to the left
+		Segment & seg = m_segments[segIdx];
+		if (!Globals::nearZero(dx)) {
+			if (seg.m_direction == Qt::Horizontal) {
+				seg.m_offset -= dx;
+				dx = 0;
+			}
+		}
+		if (!Globals::nearZero(dy)) {
+			if (seg.m_direction == Qt::Vertical) {
+				seg.m_offset -= dy;
+				dy = 0;
+			}
+		}
+	}
+
+	// we may have dx or dy left, in this case insert a new segment past the current to compensate the distance
+	if (!Globals::nearZero(dx)) {
+		Segment newSeg;
+		newSeg.m_direction = Qt::Horizontal;
+		newSeg.m_offset = -dx;
+		m_segments.append(newSeg);
+	}
+
+	if (!Globals::nearZero(dy)) {
+		Segment newSeg;
+		newSeg.m_direction = Qt::Vertical;
+		newSeg.m_offset = -dy;
+		m_segments.append(newSeg);
+	}
+	return currentIdx;
+}
+
+
+void Connector::mergeSegments() {
+	int i = 0;
+	while (i < m_segments.count()) {
+		// merge segment into previous segment with same orientation
+		if (i > 0 && m_segments[i-1].m_direction == m_segments[i].m_direction) {
+			m_segments[i-1].m_offset += m_segments[i].m_offset;
+			m_segments.removeAt(i);
+			i = 0; // try again
+			continue;
+		}
+		// remove segments with zero length
+		if (Globals::nearZero(m_segments[i].m_offset)) {
+			m_segments.removeAt(i);
+			i = 0; // try again
+			continue;
+		}
+		++i;
+	}
+}
+
+
+void Connector::writeXML(QXmlStreamWriter & writer, const QString & sourceSocket, const QString & targetSocket) const {
 	writer.writeStartElement("Connector");
 	writer.writeAttribute("name", m_name);
-	if (!m_sourceSocket.isEmpty())
-		writer.writeTextElement("Source", m_sourceSocket);
-	if (!m_targetSocket.isEmpty())
-		writer.writeTextElement("Target", m_targetSocket);
+	if (!sourceSocket.isEmpty())
+		writer.writeTextElement("Source", sourceSocket);
+	if (!targetSocket.isEmpty())
+		writer.writeTextElement("Target", targetSocket);
 	if (!m_segments.isEmpty()) {
 		writer.writeComment("Connector segments (between start and end lines)");
 		writer.writeStartElement("Segments");
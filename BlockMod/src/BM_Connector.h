@@ -40,6 +40,8 @@
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+#include "BM_Socket.h"
+
 namespace BLOCKMOD {
 
 /*! Stores properties of a Connector.
@@ -76,6 +78,21 @@ public:
 	/*! Dumps out content of block to stream writer. */
 	void writeXML(QXmlStreamWriter & writer) const;
 
+	/*! Dumps out content of block to stream writer, using the given flat names for source and target sockets
+		(used by Network::writeXML() for connectors with resolved socket handles).
+	*/
+	void writeXML(QXmlStreamWriter & writer, const QString & sourceSocket, const QString & targetSocket) const;
+
+	/*! Moves the segment with given index by dx and dy, while keeping start and end point of the connector fixed.
+		The distance is distributed to segments before and after the moved segment, new segments are inserted
+		as needed.
+		\return Returns the new index of the moved segment (changes when segments are inserted before it).
+	*/
+	int moveSegment(int segIdx, double dx, double dy);
+
+	/*! Removes segments with (near) zero length and merges neighboring segments with same direction. */
+	void mergeSegments();
+
 	/*! Unique identification name of this connector instance. */
 	QString						m_name;
 
@@ -88,13 +105,24 @@ public:
 	*/
 	QList<Segment> m_segments;
 
-	/*! ID of socket that polygon originates from, empty if not assigned.
+	/*! ID of socket that polygon originates from, empty if not assigned or already resolved.
 		Format <block-name>.<socket-name>
+
+		\note Flat names are only used to specify connections (when reading from XML or when
+			creating connectors in code). Once the connector is part of a network, Network::resolveConnector()
+			replaces the flat names with socket handles m_source and m_target and clears the strings.
+			Use Network::sourceSocketName() and Network::targetSocketName() to get flat names of
+			resolved connectors. If a flat name is set, it takes precedence over the socket handle.
 	*/
 	QString			m_sourceSocket;
-	/*! ID of socket that polygon ends in, empty if not assigned. */
+	/*! ID of socket that polygon ends in, empty if not assigned or already resolved. */
 	QString			m_targetSocket;
 
+	/*! Resolved handle of socket that polygon originates from. */
+	SocketHandle	m_source;
+	/*! Resolved handle of socket that polygon ends in. */
+	SocketHandle	m_target;
+
 	/*! Stores text that is displayed along with connector */
 	QString			m_text;
 
@@ -106,6 +134,9 @@ public:
 
 };
 
+/*! Handle to a connector in the network (see Network::m_connectors). */
+typedef SlotHandle<Connector> ConnectorHandle;
+
 } // namespace BLOCKMOD
 
 
@@ -0,0 +1,324 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BM_ConnectorPathItem.h"
+
+#include <QCursor>
+#include <QFontMetricsF>
+#include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include <algorithm>
+#include <cmath>
+
+#include "BM_Globals.h"
+#include "BM_SceneManager.h"
+#include "BM_Connector.h"
+
+namespace BLOCKMOD {
+
+/*! Maximum distance (in scene coordinates) of the mouse from a line to hit it. */
+static const double HIT_DISTANCE = 10;
+
+/*! Returns the distance of point p from the line l. */
+static double distanceToLine(const QLineF & l, const QPointF & p) {
+	double dx = l.dx();
+	double dy = l.dy();
+	double len2 = dx*dx + dy*dy;
+	double t = 0;
+	if (!Globals::nearZero(len2)) {
+		t = ((p.x() - l.p1().x())*dx + (p.y() - l.p1().y())*dy)/len2;
+		t = std::max(0.0, std::min(1.0, t));
+	}
+	QPointF closest = l.p1() + QPointF(t*dx, t*dy);
+	return QLineF(p, closest).length();
+}
+
+
+ConnectorPathItem::ConnectorPathItem(Connector * connector) :
+	ConnectorSegmentItem(connector),
+	m_dragSegmentIdx(PathSegmentIdx),
+	m_moved(false)
+{
+	m_segmentIdx = PathSegmentIdx;
+	// the item itself is never moved, only the connector segments are modified
+	setFlags(QGraphicsItem::ItemIsSelectable);
+}
+
+
+void ConnectorPathItem::setConnectorLines(const QLineF & startLine, const QLineF & endLine) {
+	prepareGeometryChange();
+
+	m_lines.clear();
+	m_lines.reserve(m_connector->m_segments.count() + 2);
+	m_lines.append(startLine);
+
+	m_path = QPainterPath();
+	m_path.moveTo(startLine.p1());
+	m_path.lineTo(startLine.p2());
+	QPointF start = startLine.p2();
+	for (int i=0; i<m_connector->m_segments.count(); ++i) {
+		const Connector::Segment & seg = m_connector->m_segments[i];
+		QPointF next(start);
+		if (seg.m_direction == Qt::Horizontal)
+			next += QPointF(seg.m_offset, 0);
+		else
+			next += QPointF(0, seg.m_offset);
+		m_lines.append(QLineF(start, next));
+		m_path.lineTo(next);
+		start = next;
+	}
+	// end line goes from socket to connection point, the path continues from the connection point to the socket
+	if (start != endLine.p2())
+		m_path.moveTo(endLine.p2());
+	m_path.lineTo(endLine.p1());
+	m_lines.append(endLine);
+
+	QPainterPathStroker stroker;
+	stroker.setWidth(2*HIT_DISTANCE);
+	m_shape = stroker.createStroke(m_path);
+
+	// label is placed in the middle of the central segment
+	m_textRect = QRectF();
+	if (!m_connector->m_text.isEmpty() && !m_connector->m_segments.isEmpty()) {
+		int idxText;
+		if (m_connector->m_segments.size() <= 2)
+			idxText = 0; // start line
+		else
+			idxText = (int)(m_connector->m_segments.size()-2) / 2 + 1;
+		const QLineF & l = m_lines[idxText + 1];
+		double x = l.p1().x() + l.dx()/2;
+		double y = l.p1().y() + l.dy()/2;
+		QFontMetricsF fm = QFontMetricsF(QFont());
+		QRectF br = fm.boundingRect(QRectF(x, y, 150, 30), 0, m_connector->m_text);
+		double width = 1.2*br.width();
+		double height = 1.2*br.height();
+		m_textRect = QRectF(x-width/2, y-height/2, width, height);
+	}
+
+	// pen may be up to 1.5 times the line width when highlighted
+	double margin = 0.75*m_connector->m_linewidth + 1;
+	m_boundingRect = m_path.boundingRect().adjusted(-margin, -margin, margin, margin);
+	if (!m_textRect.isEmpty())
+		m_boundingRect = m_boundingRect.united(m_textRect.adjusted(-1, -1, 1, 1));
+	update();
+}
+
+
+int ConnectorPathItem::segmentAt(const QPointF & pos) const {
+	int idx = PathSegmentIdx;
+	double minDist = HIT_DISTANCE;
+	for (int i=0; i<m_lines.count(); ++i) {
+		double dist = distanceToLine(m_lines[i], pos);
+		if (dist <= minDist) {
+			minDist = dist;
+			if (i == 0)
+				idx = -1; // start line
+			else if (i == m_lines.count()-1)
+				idx = -2; // end line
+			else
+				idx = i-1;
+		}
+	}
+	return idx;
+}
+
+
+QRectF ConnectorPathItem::boundingRect() const {
+	return m_boundingRect;
+}
+
+
+QPainterPath ConnectorPathItem::shape() const {
+	return m_shape;
+}
+
+
+void ConnectorPathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * option, QWidget * /*widget*/) {
+	painter->save();
+	// level of detail depends on zoom level
+	const double lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod < Globals::DetailLevelOfDetail) {
+		// zoomed out: cosmetic solid line, no text
+		QColor c = m_isHighlighted ? QColor(0,0,110) : m_connector->m_color;
+		if (isSelected())
+			c = QColor(192,0,0);
+		painter->setPen(QPen(c, 0));
+		painter->setBrush(Qt::NoBrush);
+		painter->drawPath(m_path);
+		painter->restore();
+		return;
+	}
+	QPen p;
+	p.setStyle(Qt::SolidLine);
+	if (m_isHighlighted) {
+		p.setWidthF(1.5 * m_connector->m_linewidth);
+		p.setColor(QColor(0,0,110));
+	}
+	else {
+		p.setWidthF(m_connector->m_linewidth);
+		p.setColor(m_connector->m_color);
+	}
+	if (isSelected()) {
+		p.setWidthF(1.5*m_connector->m_linewidth);
+		p.setColor(QColor(192,0,0));
+		p.setStyle(Qt::DashLine);
+	}
+	painter->setPen(p);
+	painter->setBrush(Qt::NoBrush);
+	painter->drawPath(m_path);
+
+	if (lod >= Globals::LabelLevelOfDetail && !m_textRect.isEmpty()) {
+		QPen p;
+		p.setWidthF(1);
+		p.setColor(m_connector->m_color);
+		p.setStyle(Qt::SolidLine);
+		painter->setPen(p);
+		QBrush b(Qt::white);
+		painter->setBrush(b);
+		painter->drawRect(m_textRect);
+		painter->drawText(m_textRect, Qt::AlignCenter, m_connector->m_text);
+	}
+	painter->restore();
+}
+
+
+void ConnectorPathItem::hoverEnterEvent(QGraphicsSceneHoverEvent *event) {
+	QGraphicsItem::hoverEnterEvent(event);
+	// check if scene is in connection mode, if yes, do nothing
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (sceneManager && sceneManager->isCurrentlyConnecting())
+		return;
+	// mark the entire connector as highlighted
+	if (sceneManager != nullptr)
+		sceneManager->highlightConnectorSegments(*m_connector, true);
+}
+
+
+void ConnectorPathItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event) {
+	QGraphicsItem::hoverMoveEvent(event);
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (sceneManager && sceneManager->isCurrentlyConnecting())
+		return;
+	// only regular segments can be dragged
+	int idx = segmentAt(event->pos());
+	if (idx >= 0) {
+		if (Globals::nearZero(m_lines[idx+1].dx()))
+			setCursor(Qt::SplitHCursor);
+		else
+			setCursor(Qt::SplitVCursor);
+	}
+	else
+		unsetCursor();
+}
+
+
+void ConnectorPathItem::hoverLeaveEvent(QGraphicsSceneHoverEvent *event) {
+	QGraphicsItem::hoverLeaveEvent(event);
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (sceneManager && sceneManager->isCurrentlyConnecting())
+		return;
+	unsetCursor();
+	if (sceneManager != nullptr)
+		sceneManager->highlightConnectorSegments(*m_connector, false);
+}
+
+
+void ConnectorPathItem::mousePressEvent(QGraphicsSceneMouseEvent *event) {
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (sceneManager != nullptr)
+		sceneManager->clearSelection();
+	setSelected(true);
+	QGraphicsItem::mousePressEvent(event);
+	m_moved = false;
+	m_dragSegmentIdx = PathSegmentIdx;
+	if (event->button() == Qt::LeftButton) {
+		m_dragSegmentIdx = segmentAt(event->pos());
+		m_lastPos = snapToGrid(event->scenePos());
+	}
+}
+
+
+void ConnectorPathItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
+	if (m_dragSegmentIdx < 0)
+		return;
+	QPoint p = snapToGrid(event->scenePos());
+	if (p == m_lastPos)
+		return;
+	m_moved = true;
+	QPoint moveDist = p - m_lastPos;
+	m_lastPos = p;
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (sceneManager != nullptr)
+		sceneManager->connectorAboutToMove(*m_connector);
+	// update connector segments, the segment index shifts when segments are inserted before this segment
+	m_dragSegmentIdx = m_connector->moveSegment(m_dragSegmentIdx, moveDist.x(), moveDist.y());
+	// inform scene manager to update our path
+	if (sceneManager != nullptr)
+		sceneManager->connectorSegmentMoved(this);
+}
+
+
+void ConnectorPathItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
+	QGraphicsItem::mouseReleaseEvent(event);
+	bool moved = m_moved;
+	m_moved = false;
+	m_dragSegmentIdx = PathSegmentIdx;
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (!moved || event->modifiers().testFlag(Qt::ControlModifier)) {
+		setSelected(true);
+		event->accept();
+		if (sceneManager != nullptr)
+			sceneManager->onSelectionChanged();
+		update();
+		return;
+	}
+	if (sceneManager != nullptr) {
+		sceneManager->mergeConnectorSegments(*m_connector);
+		sceneManager->onSelectionChanged();
+	}
+}
+
+
+QVariant ConnectorPathItem::itemChange(GraphicsItemChange change, const QVariant & value) {
+	return QGraphicsItem::itemChange(change, value);
+}
+
+
+QPoint ConnectorPathItem::snapToGrid(const QPointF & pos) {
+	return QPoint((int)(std::floor(pos.x() / Globals::GridSpacing) * Globals::GridSpacing),
+				  (int)(std::floor(pos.y() / Globals::GridSpacing) * Globals::GridSpacing));
+}
+
+} // namespace BLOCKMOD
@@ -0,0 +1,125 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_ConnectorPathItemH
+#define BM_ConnectorPathItemH
+
+#include <QPainterPath>
+#include <QVector>
+
+#include "BM_ConnectorSegmentItem.h"
+
+namespace BLOCKMOD {
+
+/*! Alternative connector item, that represents an entire connection (start line, all segments and end line)
+	with a single graphics item.
+	The polyline is cached as QPainterPath and only rebuilt when the connector geometry changes.
+	Dragging of individual segments is implemented by hit-testing the mouse position against the cached lines.
+
+	Using this item instead of individual segment items reduces the number of items in the scene (and in the
+	scene's BSP index) from 2 + number of segments to 1 per connector.
+	\sa SceneManager::setConnectorItemMode()
+*/
+class ConnectorPathItem : public ConnectorSegmentItem {
+public:
+	/*! Segment index used for path items (item represents all segments). */
+	static const int PathSegmentIdx = -3;
+
+	explicit ConnectorPathItem(Connector * connector);
+
+	/*! Updates the cached path and hit-test data from start line, end line and the connector's segments.
+		\param startLine Start line in scene coordinates (socket center to connection point).
+		\param endLine End line in scene coordinates (socket center to connection point).
+	*/
+	void setConnectorLines(const QLineF & startLine, const QLineF & endLine);
+
+	/*! Returns the index of the segment at the given position (in item coordinates).
+		\return Returns -1 for the start line, -2 for the end line, 0...n for regular segments
+			or PathSegmentIdx if no segment is near the given position.
+	*/
+	int segmentAt(const QPointF & pos) const;
+
+	/*! Re-implemented to return the bounding rect of the cached path (including label). */
+	virtual QRectF boundingRect() const override;
+
+	/*! Re-implemented to return the widened path for hovering/clicking. */
+	virtual QPainterPath shape() const override;
+
+protected:
+	/*! Re-implemented to draw the cached path. */
+	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+	/*! Re-implemented to highlight the entire connection. */
+	virtual void hoverEnterEvent (QGraphicsSceneHoverEvent *event) override;
+	/*! Re-implemented to update the cursor depending on the hovered segment. */
+	virtual void hoverMoveEvent (QGraphicsSceneHoverEvent *event) override;
+	/*! Re-implemented to turn off highlighting of the entire connection. */
+	virtual void hoverLeaveEvent (QGraphicsSceneHoverEvent *event) override;
+
+	/*! Re-implemented to select the connector and start dragging the segment under the mouse. */
+	virtual void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+	/*! Re-implemented to move the dragged segment in grid steps. */
+	virtual void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+	/*! Re-implemented to merge connector segments after dragging. */
+	virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
+
+	/*! Re-implemented to bypass the move logic of segment items. */
+	virtual QVariant itemChange(GraphicsItemChange change, const QVariant & value) override;
+
+private:
+	/*! Returns the grid-snapped position. */
+	static QPoint snapToGrid(const QPointF & pos);
+
+	/*! Cached polyline of the entire connector. */
+	QPainterPath		m_path;
+	/*! Cached widened path used for hit testing. */
+	QPainterPath		m_shape;
+	/*! Cached lines of the connector: start line, segments 0...n-1, end line. */
+	QVector<QLineF>		m_lines;
+	/*! Rectangle of the label (empty, if connector has no text). */
+	QRectF				m_textRect;
+	/*! Cached bounding rect. */
+	QRectF				m_boundingRect;
+
+	/*! Index of the segment currently being dragged, PathSegmentIdx if none. */
+	int					m_dragSegmentIdx;
+	/*! Indicates, that a segment has been moved during the current drag operation. */
+	bool				m_moved;
+	/*! Last grid-snapped mouse position during dragging. */
+	QPoint				m_lastPos;
+};
+
+} // namespace BLOCKMOD
+
+
+#endif // BM_ConnectorPathItemH
@@ -34,10 +34,12 @@
 #include "BM_ConnectorSegmentItem.h"
 
 #include <QApplication>
+#include <QFontMetricsF>
 #include <QGraphicsSceneMouseEvent>
 #include <QDebug>
 #include <QPainter>
 #include <QRectF>
+#include <QStyleOptionGraphicsItem>
 
 #include <cmath>
 
@@ -60,17 +62,41 @@ ConnectorSegmentItem::ConnectorSegmentItem(Connector * connector) :
 
 void ConnectorSegmentItem::setLine(const QLineF &line) {
 	m_lastPos = pos().toPoint();
+	// segments of the connector may have changed, and with them the segment that holds the text
+	prepareGeometryChange();
+	updateTextSize();
 	QGraphicsLineItem::setLine(line);
 }
 
 
-void ConnectorSegmentItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*option*/, QWidget * /*widget*/) {
+void ConnectorSegmentItem::setSegmentIndex(int segmentIdx) {
+	if (segmentIdx == m_segmentIdx)
+		return;
+	prepareGeometryChange();
+	m_segmentIdx = segmentIdx;
+	updateTextSize();
+}
+
+
+void ConnectorSegmentItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * option, QWidget * /*widget*/) {
 	// don't draw zero length lines (appear before merge during draggging or while in connection mode)
 	QLineF l = line();
 	if (Globals::nearZero(l.length()))
 		return;
 
 	painter->save();
+	// level of detail depends on zoom level
+	const double lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod < Globals::DetailLevelOfDetail) {
+		// zoomed out: cosmetic solid line, no text
+		QColor c = m_isHighlighted ? QColor(0,0,110) : m_connector->m_color;
+		if (isSelected())
+			c = QColor(192,0,0);
+		painter->setPen(QPen(c, 0));
+		painter->drawLine(l);
+		painter->restore();
+		return;
+	}
 	if (m_isHighlighted) {
 		QPen p;
 		p.setWidthF(1.5 * m_connector->m_linewidth);
@@ -99,7 +125,7 @@ void ConnectorSegmentItem::paint(QPainter *painter, const QStyleOptionGraphicsIt
 	}
 
 	// determine index of central segment
-	if (!m_connector->m_text.isEmpty()) {
+	if (lod >= Globals::LabelLevelOfDetail && !m_connector->m_text.isEmpty()) {
 		int idxText;
 		Q_ASSERT(m_connector->m_segments.size() != 0);
 		if (m_connector->m_segments.size() <= 2)
@@ -220,124 +246,12 @@ QVariant ConnectorSegmentItem::itemChange(GraphicsItemChange change, const QVari
 			// compute move offset
 			QPoint moveDist = p-m_lastPos;
 
-			// update connector segments
-
-			// we must distribute the dx and dy to both sides of the moved connector
-			// modifying the offsets in connector segments with lower index will move the currently
-			// selected segment accordingly.
-
-			// For example: Suppose the mouse was moved by 8 pixels to the right.
-			//              a) the start position is to the left, then we need to reduce the offset of the
-			//                 first horizontal segments before the current segment by 8 pixels.
-			//              b) the start position is to the right, then the distance is reduced.
-			// Algorithm:
-			// - process all segments to the left of the connector and distribute dx and dy
-			// - if afterwards dx and dy is still != 0, check if this segment can be extended to compensate
-			// - if not (different direction), insert a new line segment left of this position with the matching direction and offset
-
-			// Source/Start-direction
-
-			int segIdx = m_segmentIdx;
-			Q_ASSERT(segIdx < m_connector->m_segments.size());
-
-			double dx = moveDist.x();
-			double dy = moveDist.y();
-
-			while ((--segIdx >= 0) && (!Globals::nearZero(dx) || !Globals::nearZero(dy)) ) {
-				// get next segment to the left
-				Connector::Segment & seg = m_connector->m_segments[segIdx];
-				if (!Globals::nearZero(dx)) {
-					if (seg.m_direction == Qt::Horizontal) {
-						seg.m_offset += dx;
-						dx = 0;
-					}
-				}
-				if (!Globals::nearZero(dy)) {
-					if (seg.m_direction == Qt::Vertical) {
-						seg.m_offset += dy;
-						dy = 0;
-					}
-				}
-			}
-
-			// reset segment index for currently selected segment
-			segIdx = m_segmentIdx;
-
-			// we may have dx or dy left, in this case insert a new segment before the current to compensate the distance
-			if (!Globals::nearZero(dx)) {
-				// check, if we can extend the currently selected segment
-				Connector::Segment & seg = m_connector->m_segments[segIdx];
-				if (seg.m_direction == Qt::Horizontal) {
-					seg.m_offset += dx;
-				}
-				else {
-					Connector::Segment newSeg;
-					newSeg.m_direction = Qt::Horizontal;
-					newSeg.m_offset = dx;
-					dx = 0;
-					// always insert as first element - since we checked for the presence of horizontal
-					// segments above, and we know there are none - we can savely assume
-					// that we have no horizontal segment at the begin
-					m_connector->m_segments.insert(0, newSeg);
-					++segIdx; // mind, our own segment index has shifted
-					m_segmentIdx = segIdx;
-				}
-			}
-
-			if (!Globals::nearZero(dy)) {
-				Connector::Segment & seg = m_connector->m_segments[segIdx];
-				if (seg.m_direction == Qt::Vertical) {
-					seg.m_offset += dy;
-				}
-				else {
-					Connector::Segment newSeg;
-					newSeg.m_direction = Qt::Vertical;
-					newSeg.m_offset = dy;
-					dy = 0;
-					m_connector->m_segments.insert(0, newSeg);
-					++segIdx; // mind, our own segment index has shifted
-					m_segmentIdx = segIdx;
-				}
-			}
-
-
-			// same for the connectors towards the end
-			dx = moveDist.x();
-			dy = moveDist.y();
-
-			while (++segIdx < m_connector->m_segments.count() && (!Globals::nearZero(dx) || !Globals::nearZero(dy)) ) {
-				// get next segment to the left
-				Connector::Segment & seg = m_connector->m_segments[segIdx];
-				if (!Globals::nearZero(dx)) {
-					if (seg.m_direction == Qt::Horizontal) {
-						seg.m_offset -= dx;
-						dx = 0;
-					}
-				}
-				if (!Globals::nearZero(dy)) {
-					if (seg.m_direction == Qt::Vertical) {
-						seg.m_offset -= dy;
-						dy = 0;
-					}
-				}
-			}
-
-			// we may have dx or dy left, in this case insert a new segment past the current to compensate the distance
-			if (!Globals::nearZero(dx)) {
-				Connector::Segment newSeg;
-				newSeg.m_direction = Qt::Horizontal;
-				newSeg.m_offset = -dx;
-				dx = 0;
-				m_connector->m_segments.append(newSeg);
-			}
-
-			if (!Globals::nearZero(dy)) {
-				Connector::Segment newSeg;
-				newSeg.m_direction = Qt::Vertical;
-				newSeg.m_offset = -dy;
-				dy = 0;
-				m_connector->m_segments.append(newSeg);
-			}
+			SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+			if (sceneManager != nullptr)
+				sceneManager->connectorAboutToMove(*m_connector);
+
+			// update connector segments, the segment index shifts when segments are inserted before this segment
+			setSegmentIndex(m_connector->moveSegment(m_segmentIdx, moveDist.x(), moveDist.y()));
 
 			// manually correct the line's coordinates
 
@@ -345,7 +259,6 @@ QVariant ConnectorSegmentItem::itemChange(GraphicsItemChange change, const QVari
 
 			// Note: when the sceneManager calls setLine() in this line segment, it already gives new scene coordinates.
 			//       However, at the end of the function, also the position of line is modified. Thus, the line is moved twice the distance.
-			SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
 			if (sceneManager != nullptr)
 				sceneManager->connectorSegmentMoved(this);
 
@@ -364,6 +277,46 @@ QVariant ConnectorSegmentItem::itemChange(GraphicsItemChange change, const QVari
 }
 
 
+QRectF ConnectorSegmentItem::boundingRect() const {
+	QLineF l = line();
+	// pen may be up to 1.5 times the line width when highlighted or selected
+	double margin = 0.75*m_connector->m_linewidth + 1;
+	QRectF r = QRectF(l.p1(), l.p2()).normalized().adjusted(-margin, -margin, margin, margin);
+
+	// same placement as in paint()
+	if (!m_textSize.isEmpty()) {
+		double x = l.p1().x() + l.dx()/2;
+		double y = l.p1().y() + l.dy()/2;
+		double width = m_textSize.width();
+		double height = m_textSize.height();
+		r = r.united(QRectF(x-width/2-1, y-height/2-1, width+2, height+2));
+	}
+	return r;
+}
+
+
+void ConnectorSegmentItem::updateTextSize() {
+	m_textSize = QSizeF();
+	if (m_connector->m_text.isEmpty() || m_connector->m_segments.isEmpty())
+		return;
+	// same segment as in paint()
+	int idxText;
+	if (m_connector->m_segments.size() <= 2)
+		idxText = 0; // start line
+	else
+		idxText = (int)(m_connector->m_segments.size()-2) / 2 + 1;
+	if (m_segmentIdx != idxText)
+		return;
+	if (m_measuredText != m_connector->m_text || m_measuredTextSize.isEmpty()) {
+		QFontMetricsF fm = QFontMetricsF(QFont());
+		QRectF br = fm.boundingRect(QRectF(0, 0, 150, 30), 0, m_connector->m_text);
+		m_measuredText = m_connector->m_text;
+		m_measuredTextSize = QSizeF(1.2*br.width(), 1.2*br.height());
+	}
+	m_textSize = m_measuredTextSize;
+}
+
+
 QPainterPath ConnectorSegmentItem::shape() const {
 	QPainterPath path;
 	qreal x = line().p1().x() -10;
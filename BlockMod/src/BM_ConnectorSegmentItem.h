@@ -35,6 +35,8 @@
 #define BM_ConnectorSegmentItemH
 
 #include <QGraphicsLineItem>
+#include <QSizeF>
+#include <QString>
 
 namespace BLOCKMOD {
 
@@ -45,9 +47,19 @@ class ConnectorSegmentItem : public QGraphicsLineItem {
 public:
 	explicit ConnectorSegmentItem(Connector * connector);
 
-	/*! Re-implemented to initialize m_lastPos. */
+	/*! Re-implemented to initialize m_lastPos and to update the cached text size. */
 	void setLine(const QLineF &line);
 
+	/*! Sets the segment index (see m_segmentIdx), updates the geometry if the connector text moves
+		to or away from this segment.
+	*/
+	void setSegmentIndex(int segmentIdx);
+
+	/*! Re-implemented to include the highlighted/selected pen width and the connector text
+		(drawn on the central segment), so that partial viewport updates repaint the entire item.
+		Uses the cached text size, call setLine() or setSegmentIndex() after changing the connector's text or segments.
+	*/
+	QRectF boundingRect() const override;
 
 	/*! The connector, that this line segment belongs to. */
 	Connector	*m_connector;
@@ -92,6 +104,16 @@ private:
 		\note Position of the line is not the same as p1 and p2, which are changed with setLine().
 	*/
 	QPoint		m_lastPos;
+
+	/*! Updates m_textSize, the text is only measured again if it has been changed. */
+	void updateTextSize();
+
+	/*! Size of the text box drawn on this segment, empty if the connector text is drawn on another segment. */
+	QSizeF		m_textSize;
+	/*! Connector text that m_textSize was computed for. */
+	QString		m_measuredText;
+	/*! Size of the text box of m_measuredText (independent of segment). */
+	QSizeF		m_measuredTextSize;
 };
 
 } // namespace BLOCKMOD
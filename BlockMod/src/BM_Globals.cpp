@@ -45,6 +45,18 @@ double Globals::GridSpacing = 8; // in pixel
 
 double Globals::LabelFontSize = 8;
 
+double Globals::LabelLevelOfDetail = 0.5;
+
+double Globals::DetailLevelOfDetail = 0.4;
+
+double Globals::SocketPointLevelOfDetail = 0.25;
+
+double Globals::SocketHiddenLevelOfDetail = 0.1;
+
+int Globals::DragUpdateInterval = 16; // in ms
+
+int Globals::SmallRemovalCount = 64;
+
 const char * const Globals::InvisibleLabel = "[(-I am invisible-)]";
 
 
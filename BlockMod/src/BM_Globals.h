@@ -47,9 +47,34 @@ public:
 	/*! The grid spacing, used to align blocks/connectors/sockets and snap to while moving. */
 	static double GridSpacing;
 
-	/*! Size of labels to draw on sockets. */
+	/*! Size of labels to draw on sockets. After changing the size, call SceneManager::updateSocketLabels(). */
 	static double LabelFontSize;
 
+	/*! Level of detail (scale factor of the view, see QStyleOptionGraphicsItem::levelOfDetailFromTransform())
+		below which block names, socket labels and connector texts are not drawn.
+	*/
+	static double LabelLevelOfDetail;
+
+	/*! Level of detail below which gradients, pixmaps and antialiasing are replaced by flat fills
+		and aliased, cosmetic lines.
+	*/
+	static double DetailLevelOfDetail;
+
+	/*! Level of detail below which sockets are drawn as single points. */
+	static double SocketPointLevelOfDetail;
+
+	/*! Level of detail below which sockets are not drawn at all. */
+	static double SocketHiddenLevelOfDetail;
+
+	/*! Interval in ms in which connectors are updated while dragging blocks (coalesced drag mode),
+		about one frame.
+	*/
+	static int DragUpdateInterval;
+	/*! Maximum number of blocks/connectors that are removed one by one. When removing more elements,
+		block and connector lists are compacted in a single pass instead.
+	*/
+	static int SmallRemovalCount;
+
 	/*! Constant to identify hidden block used during connection operation. */
 	static const char * const InvisibleLabel;
 };
@@ -37,20 +37,37 @@
 #include <QXmlStreamWriter>
 #include <QFile>
 #include <QSet>
+#include <QVector>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <QDebug>
 
 #include <stdexcept>
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstring>
 
 #include "BM_Block.h"
 #include "BM_Connector.h"
 #include "BM_XMLHelpers.h"
 #include "BM_Globals.h"
+#include "BM_BinaryFormat.h"
 
 namespace BLOCKMOD {
 
-Network::Network()
+Network::Network() :
+	m_indexedBlockCount(0),
+	m_adjacencyConnectorCount(0),
+	m_adjacencyEraseCount(0),
+	m_resolvedConnectorCount(0),
+	m_resolveEraseCount(0),
+	m_blockGrid(16*Globals::GridSpacing),
+	m_gridBlockCount(0),
+	m_gridBlockEraseCount(0),
+	m_connectorGrid(16*Globals::GridSpacing),
+	m_gridConnectorCount(0),
+	m_gridConnectorEraseCount(0)
 {
 }
 
@@ -58,6 +75,23 @@ Network::Network()
 void Network::swap(Network & other) {
 	other.m_blocks.swap(m_blocks);
 	other.m_connectors.swap(m_connectors);
+	other.m_blockIndex.swap(m_blockIndex);
+	other.m_socketIndex.swap(m_socketIndex);
+	std::swap(other.m_indexedBlockCount, m_indexedBlockCount);
+	other.m_incomingConnectors.swap(m_incomingConnectors);
+	other.m_outgoingConnectors.swap(m_outgoingConnectors);
+	other.m_blockConnectors.swap(m_blockConnectors);
+	std::swap(other.m_adjacencyConnectorCount, m_adjacencyConnectorCount);
+	std::swap(other.m_adjacencyEraseCount, m_adjacencyEraseCount);
+	std::swap(other.m_resolvedConnectorCount, m_resolvedConnectorCount);
+	std::swap(other.m_resolveEraseCount, m_resolveEraseCount);
+	other.m_unresolvedConnectors.swap(m_unresolvedConnectors);
+	other.m_blockGrid.swap(m_blockGrid);
+	std::swap(other.m_gridBlockCount, m_gridBlockCount);
+	std::swap(other.m_gridBlockEraseCount, m_gridBlockEraseCount);
+	other.m_connectorGrid.swap(m_connectorGrid);
+	std::swap(other.m_gridConnectorCount, m_gridConnectorCount);
+	std::swap(other.m_gridConnectorEraseCount, m_gridConnectorEraseCount);
 }
 
 
@@ -67,8 +101,24 @@ void Network::readXML(const QString & fname) {
 	if (!xmlFile.open(QIODevice::ReadOnly | QFile::Text))
 		throw std::runtime_error("Cannot read file.");
 
-	QXmlStreamReader reader(&xmlFile);
+	readXML(xmlFile);
+}
+
+
+void Network::readXML(QIODevice & device) {
+	QXmlStreamReader reader(&device);
+	readXML(reader);
+
+	if (reader.hasError()) {
+		throw std::runtime_error( reader.errorString().toStdString() );
+	}
+
+	// replace flat names in connectors by socket handles
+	resolveConnectors();
+}
 
+
+void Network::readXML(QXmlStreamReader & reader) {
 	// we start reading the XML
 	while (!reader.atEnd() && !reader.hasError()) {
 		reader.readNext();
@@ -102,13 +152,163 @@ void Network::readXML(const QString & fname) {
 			}
 		}
 	}
+}
 
-	if (reader.hasError()) {
-		throw std::runtime_error( reader.errorString().toStdString() );
+
+/*! A chunk of child elements of a section in the raw XML data, parsed by readXMLChunk(). */
+template <typename T>
+struct XMLChunk {
+	/*! Raw XML data of the entire document. */
+	const QByteArray	*m_data;
+	/*! Name of the section element that holds the child elements. */
+	QByteArray			m_sectionName;
+	/*! Byte offset of first child element in chunk. */
+	int					m_begin;
+	/*! Byte offset past the last child element in chunk. */
+	int					m_end;
+	/*! Objects read from the chunk. */
+	QList<T>			m_objects;
+	/*! True, if chunk was read successfully. */
+	bool				m_ok;
+};
+
+
+/*! Reads all objects in a chunk with a separate XML stream reader, using the same readList() function
+	as the sequential reader. The child elements are wrapped into the section element, so that the
+	reader sees a well-formed document.
+*/
+template <typename T>
+static void readXMLChunk(XMLChunk<T> & chunk) {
+	chunk.m_ok = false;
+	QByteArray fragment;
+	fragment.reserve(chunk.m_end - chunk.m_begin + 2*chunk.m_sectionName.size() + 5);
+	fragment.append('<').append(chunk.m_sectionName).append('>');
+	fragment.append(chunk.m_data->constData() + chunk.m_begin, chunk.m_end - chunk.m_begin);
+	fragment.append("</").append(chunk.m_sectionName).append('>');
+	try {
+		QXmlStreamReader reader(fragment);
+		if (!reader.readNextStartElement())
+			return;
+		readList(reader, chunk.m_objects);
+		// readList() must have stopped at the end of the wrapping section element, otherwise the
+		// elements in the chunk were not read the same way as by the sequential reader
+		if (reader.hasError() || !reader.isEndElement() || reader.name() != QLatin1String(chunk.m_sectionName))
+			return;
+		// remaining data must only be the end of the document
+		while (!reader.atEnd() && !reader.hasError())
+			reader.readNext();
+		chunk.m_ok = !reader.hasError();
+	}
+	catch (...) {
+		// errors are reported by the sequential reader
 	}
 }
 
 
+/*! Splits the child elements of a section into chunks of roughly equal size (in bytes). */
+template <typename T>
+static QVector<XMLChunk<T> > createXMLChunks(const QByteArray & data, const XMLSectionRange & section, int chunkCount) {
+	QVector<XMLChunk<T> > chunks;
+	const QVector<int> & childBegins = section.m_childBegins;
+	if (childBegins.isEmpty())
+		return chunks;
+	const int targetSize = std::max(1, (section.m_contentEnd - childBegins.front()) / std::max(1, chunkCount));
+	int begin = childBegins.front();
+	for (int i=1; i<=childBegins.count(); ++i) {
+		int end = (i == childBegins.count()) ? section.m_contentEnd : childBegins[i];
+		if (end - begin >= targetSize || i == childBegins.count()) {
+			XMLChunk<T> chunk;
+			chunk.m_data = &data;
+			chunk.m_sectionName = section.m_name;
+			chunk.m_begin = begin;
+			chunk.m_end = end;
+			chunk.m_ok = false;
+			chunks.append(chunk);
+			begin = end;
+		}
+	}
+	return chunks;
+}
+
+
+void Network::readXMLParallel(const QString & fname) {
+	QFile xmlFile(fname);
+	if (!xmlFile.open(QIODevice::ReadOnly))
+		throw std::runtime_error("Cannot read file.");
+	QByteArray data = xmlFile.readAll();
+	xmlFile.close();
+
+	// locate block and connector elements in the raw data
+	QList<XMLSectionRange> sections;
+	if (!scanXMLSections(data, QList<QByteArray>() << "Blocks" << "Connectors", sections)) {
+		// document cannot be split, read it sequentially
+		readXML(fname);
+		return;
+	}
+
+	// create chunks, several per thread to balance the load
+	const int chunkCount = 4*std::max(1, QThread::idealThreadCount());
+	QVector<XMLChunk<Block> > blockChunks;
+	QVector<XMLChunk<Connector> > connectorChunks;
+	for (const XMLSectionRange & section : sections) {
+		if (section.m_name == "Blocks")
+			blockChunks = createXMLChunks<Block>(data, section, chunkCount);
+		else
+			connectorChunks = createXMLChunks<Connector>(data, section, chunkCount);
+	}
+
+	// parse chunks in parallel
+	QtConcurrent::blockingMap(blockChunks, &readXMLChunk<Block>);
+	QtConcurrent::blockingMap(connectorChunks, &readXMLChunk<Connector>);
+
+	// check remaining document structure (without section content) with the sequential reader
+	QByteArray remainder;
+	int pos = 0;
+	for (const XMLSectionRange & section : sections) {
+		remainder.append(data.constData() + pos, section.m_contentBegin - pos);
+		pos = section.m_contentEnd;
+	}
+	remainder.append(data.constData() + pos, data.size() - pos);
+	data.clear();
+	bool ok;
+	{
+		Network structure;
+		QXmlStreamReader reader(remainder);
+		structure.readXML(reader);
+		ok = !reader.hasError();
+	}
+	for (const XMLChunk<Block> & chunk : blockChunks)
+		ok = ok && chunk.m_ok;
+	for (const XMLChunk<Connector> & chunk : connectorChunks)
+		ok = ok && chunk.m_ok;
+	if (!ok) {
+		// read file sequentially to get exactly the same result/error message as readXML()
+		readXML(fname);
+		return;
+	}
+
+	// concatenate objects in original order
+	for (XMLChunk<Block> & chunk : blockChunks) {
+		for (Block & b : chunk.m_objects)
+			m_blocks.push_back(std::move(b));
+	}
+	for (XMLChunk<Connector> & chunk : connectorChunks) {
+		for (Connector & c : chunk.m_objects)
+			m_connectors.push_back(std::move(c));
+	}
+
+	// replace flat names in connectors by socket handles
+	resolveConnectors();
+}
+
+
+Network Network::fromXML(const QString & fname) {
+	Network network;
+	network.readXML(fname);
+	return network;
+}
+
+
 void Network::writeXML(const QString & fname) const {
 
 	QFile xmlFile(fname);
@@ -134,7 +334,7 @@ void Network::writeXML(const QString & fname) const {
 		stream.writeComment("Connectors");
 		stream.writeStartElement("Connectors");
 		for (const Connector & c : m_connectors)
-			c.writeXML(stream);
+			c.writeXML(stream, sourceSocketName(c), targetSocketName(c));
 
 		stream.writeEndElement(); // Connectors
 	}
@@ -146,6 +346,342 @@ void Network::writeXML(const QString & fname) const {
 }
 
 
+/*! Reads record number idx of a section starting at sectionOffset.
+	Records are copied, since the data buffer is not guaranteed to be aligned.
+*/
+template <typename T>
+static T readRecord(const uchar * data, quint64 sectionOffset, quint32 idx) {
+	T rec;
+	std::memcpy(&rec, data + sectionOffset + (quint64)idx*sizeof(T), sizeof(T));
+	return rec;
+}
+
+
+/*! Throws an exception, if a section with count records of given size does not fit into the file. */
+static void checkBinarySection(quint64 sectionOffset, quint64 count, quint64 recordSize, quint64 fileSize) {
+	if (sectionOffset > fileSize || count*recordSize > fileSize - sectionOffset)
+		throw std::runtime_error("Invalid binary file, section exceeds file size.");
+}
+
+
+/*! Throws an exception, if the range [first, first+count) is not within [0, size). */
+static void checkBinaryRange(quint32 first, quint32 count, quint32 size) {
+	if (first > size || count > size - first)
+		throw std::runtime_error("Invalid binary file, record index out of range.");
+}
+
+
+/*! Writes the data to the file and pads the section with zeros to the next 8-byte boundary. */
+static void writeBinarySection(QFile & file, const void * data, quint64 size) {
+	static const char ZEROS[8] = {0};
+	if (size != 0 && file.write(reinterpret_cast<const char*>(data), (qint64)size) != (qint64)size)
+		throw std::runtime_error("Error writing output file.");
+	quint64 padding = (8 - size % 8) % 8;
+	if (padding != 0 && file.write(ZEROS, (qint64)padding) != (qint64)padding)
+		throw std::runtime_error("Error writing output file.");
+}
+
+
+/*! Returns the size rounded up to the next 8-byte boundary. */
+static quint64 alignedSectionSize(quint64 size) {
+	return (size + 7) & ~quint64(7);
+}
+
+
+void Network::readBinary(const QString & fname) {
+	QFile file(fname);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::runtime_error("Cannot read file.");
+
+	// map the file into memory, so that records are read directly from the page cache
+	quint64 fileSize = (quint64)file.size();
+	const uchar * data = nullptr;
+	QByteArray buffer;
+	if (fileSize != 0)
+		data = file.map(0, (qint64)fileSize);
+	if (data == nullptr) {
+		// device does not support mapping, read the entire file instead
+		buffer = file.readAll();
+		data = reinterpret_cast<const uchar*>(buffer.constData());
+		fileSize = (quint64)buffer.size();
+	}
+
+	using namespace BinaryFormat;
+	if (fileSize < sizeof(FileHeader))
+		throw std::runtime_error("Invalid binary file, file is too short.");
+	FileHeader header = readRecord<FileHeader>(data, 0, 0);
+	if (header.m_magic != MAGIC)
+		throw std::runtime_error("Invalid binary file, expected BlockMod binary format.");
+	if (header.m_byteOrderMark != BYTE_ORDER_MARK)
+		throw std::runtime_error("Binary file was written on a machine with different byte order, use XML format for exchanging networks.");
+	if (header.m_version != VERSION)
+		throw std::runtime_error("Unsupported binary file version.");
+	if (header.m_fileSize != fileSize)
+		throw std::runtime_error("Invalid binary file, file size mismatch (truncated file?).");
+	checkBinarySection(header.m_stringTableOffset, (quint64)header.m_stringCount + 1, sizeof(quint32), fileSize);
+	checkBinarySection(header.m_blockOffset, header.m_blockCount, sizeof(BlockRecord), fileSize);
+	checkBinarySection(header.m_socketOffset, header.m_socketCount, sizeof(SocketRecord), fileSize);
+	checkBinarySection(header.m_propertyOffset, header.m_propertyCount, sizeof(PropertyRecord), fileSize);
+	checkBinarySection(header.m_connectorOffset, header.m_connectorCount, sizeof(ConnectorRecord), fileSize);
+	checkBinarySection(header.m_segmentOffset, header.m_segmentCount, sizeof(SegmentRecord), fileSize);
+
+	// create all strings, the string table holds start positions of all strings and the end of the last string
+	quint32 stringDataSize = readRecord<quint32>(data, header.m_stringTableOffset, header.m_stringCount);
+	checkBinarySection(header.m_stringDataOffset, stringDataSize, sizeof(ushort), fileSize);
+	QVector<QString> strings(header.m_stringCount);
+	quint32 start = readRecord<quint32>(data, header.m_stringTableOffset, 0);
+	for (quint32 i=0; i<header.m_stringCount; ++i) {
+		quint32 end = readRecord<quint32>(data, header.m_stringTableOffset, i+1);
+		if (start > end || end > stringDataSize)
+			throw std::runtime_error("Invalid binary file, corrupt string table.");
+		QString & s = strings[(int)i];
+		s.resize((int)(end - start));
+		std::memcpy(s.data(), data + header.m_stringDataOffset + (quint64)start*sizeof(ushort), (end - start)*sizeof(ushort));
+		start = end;
+	}
+
+	// read blocks
+	const size_t blockBase = m_blocks.size();
+	m_blocks.reserve(blockBase + header.m_blockCount);
+	for (quint32 i=0; i<header.m_blockCount; ++i) {
+		BlockRecord br = readRecord<BlockRecord>(data, header.m_blockOffset, i);
+		checkBinaryRange(br.m_name, 1, header.m_stringCount);
+		checkBinaryRange(br.m_firstSocket, br.m_socketCount, header.m_socketCount);
+		checkBinaryRange(br.m_firstProperty, br.m_propertyCount, header.m_propertyCount);
+		Block b;
+		b.m_name = strings[(int)br.m_name];
+		b.m_pos = QPointF(br.m_x, br.m_y);
+		b.m_size = QSizeF(br.m_width, br.m_height);
+		b.m_connectionHelperBlock = (br.m_flags & BF_ConnectionHelperBlock) != 0;
+		b.m_sockets.reserve((int)br.m_socketCount);
+		for (quint32 j=0; j<br.m_socketCount; ++j) {
+			SocketRecord sr = readRecord<SocketRecord>(data, header.m_socketOffset, br.m_firstSocket + j);
+			checkBinaryRange(sr.m_name, 1, header.m_stringCount);
+			b.m_sockets.append( Socket(strings[(int)sr.m_name], QPointF(sr.m_x, sr.m_y),
+									   (sr.m_flags & SF_Vertical) ? Qt::Vertical : Qt::Horizontal, (sr.m_flags & SF_Inlet) != 0) );
+		}
+		for (quint32 j=0; j<br.m_propertyCount; ++j) {
+			PropertyRecord pr = readRecord<PropertyRecord>(data, header.m_propertyOffset, br.m_firstProperty + j);
+			checkBinaryRange(pr.m_key, 1, header.m_stringCount);
+			checkBinaryRange(pr.m_value, 1, header.m_stringCount);
+			QVariant value(strings[(int)pr.m_value]);
+			if (pr.m_type != QMetaType::QString)
+				value.convert(pr.m_type);
+			b.m_properties.insert(strings[(int)pr.m_key], value);
+		}
+		m_blocks.push_back(std::move(b));
+	}
+
+	// read connectors, sockets are referenced by index, so we can create the socket handles directly
+	m_connectors.reserve(m_connectors.size() + header.m_connectorCount);
+	for (quint32 i=0; i<header.m_connectorCount; ++i) {
+		ConnectorRecord cr = readRecord<ConnectorRecord>(data, header.m_connectorOffset, i);
+		checkBinaryRange(cr.m_name, 1, header.m_stringCount);
+		checkBinaryRange(cr.m_text, 1, header.m_stringCount);
+		checkBinaryRange(cr.m_firstSegment, cr.m_segmentCount, header.m_segmentCount);
+		Connector con;
+		con.m_name = strings[(int)cr.m_name];
+		con.m_text = strings[(int)cr.m_text];
+		con.m_linewidth = cr.m_linewidth;
+		con.m_color = QColor::fromRgba(cr.m_color);
+		if (cr.m_flags & CF_SourceFlatName) {
+			checkBinaryRange(cr.m_sourceBlock, 1, header.m_stringCount);
+			con.m_sourceSocket = strings[(int)cr.m_sourceBlock];
+		}
+		else {
+			checkBinaryRange(cr.m_sourceBlock, 1, header.m_blockCount);
+			checkBinaryRange(cr.m_sourceSocket, 1, (quint32)m_blocks[blockBase + cr.m_sourceBlock].m_sockets.count());
+			con.m_source = SocketHandle(m_blocks.handle(blockBase + cr.m_sourceBlock), (int)cr.m_sourceSocket);
+		}
+		if (cr.m_flags & CF_TargetFlatName) {
+			checkBinaryRange(cr.m_targetBlock, 1, header.m_stringCount);
+			con.m_targetSocket = strings[(int)cr.m_targetBlock];
+		}
+		else {
+			checkBinaryRange(cr.m_targetBlock, 1, header.m_blockCount);
+			checkBinaryRange(cr.m_targetSocket, 1, (quint32)m_blocks[blockBase + cr.m_targetBlock].m_sockets.count());
+			con.m_target = SocketHandle(m_blocks.handle(blockBase + cr.m_targetBlock), (int)cr.m_targetSocket);
+		}
+		con.m_segments.reserve((int)cr.m_segmentCount);
+		for (quint32 j=0; j<cr.m_segmentCount; ++j) {
+			SegmentRecord sr = readRecord<SegmentRecord>(data, header.m_segmentOffset, cr.m_firstSegment + j);
+			con.m_segments.append( Connector::Segment(sr.m_direction == Qt::Vertical ? Qt::Vertical : Qt::Horizontal, sr.m_offset) );
+		}
+		m_connectors.push_back(std::move(con));
+	}
+
+	// resolve connectors that were stored with flat names
+	resolveConnectors();
+}
+
+
+Network Network::fromBinary(const QString & fname) {
+	Network network;
+	network.readBinary(fname);
+	return network;
+}
+
+
+void Network::writeBinary(const QString & fname) const {
+	using namespace BinaryFormat;
+
+	// string table, each distinct string is stored only once
+	QHash<QString, quint32> stringIndex;
+	QVector<quint32> stringTable;
+	QString stringData;
+	stringTable.append(0);
+	auto addString = [&stringIndex, &stringTable, &stringData](const QString & s) -> quint32 {
+		QHash<QString, quint32>::const_iterator it = stringIndex.constFind(s);
+		if (it != stringIndex.constEnd())
+			return it.value();
+		quint32 idx = (quint32)stringTable.count() - 1;
+		stringIndex.insert(s, idx);
+		stringData.append(s);
+		stringTable.append((quint32)stringData.size());
+		return idx;
+	};
+
+	// blocks with their sockets and properties
+	QVector<BlockRecord> blocks;
+	QVector<SocketRecord> sockets;
+	QVector<PropertyRecord> properties;
+	blocks.reserve((int)m_blocks.size());
+	// position of each block in m_blocks, indexed by slot index of the block handle
+	QVector<quint32> blockPositions;
+	for (size_t i=0; i<m_blocks.size(); ++i) {
+		const Block & b = m_blocks[i];
+		BlockRecord br;
+		std::memset(&br, 0, sizeof(BlockRecord));
+		br.m_name = addString(b.m_name);
+		br.m_flags = b.m_connectionHelperBlock ? BF_ConnectionHelperBlock : 0;
+		br.m_firstSocket = (quint32)sockets.count();
+		br.m_socketCount = (quint32)b.m_sockets.count();
+		br.m_firstProperty = (quint32)properties.count();
+		br.m_propertyCount = (quint32)b.m_properties.count();
+		br.m_x = b.m_pos.x();
+		br.m_y = b.m_pos.y();
+		br.m_width = b.m_size.width();
+		br.m_height = b.m_size.height();
+		blocks.append(br);
+		for (const Socket & s : b.m_sockets) {
+			SocketRecord sr;
+			std::memset(&sr, 0, sizeof(SocketRecord));
+			sr.m_name = addString(s.m_name);
+			sr.m_flags = (s.m_inlet ? SF_Inlet : 0) | (s.m_orientation == Qt::Vertical ? SF_Vertical : 0);
+			sr.m_x = s.m_pos.x();
+			sr.m_y = s.m_pos.y();
+			sockets.append(sr);
+		}
+		for (QMap<QString, QVariant>::const_iterator it = b.m_properties.constBegin(); it != b.m_properties.constEnd(); ++it) {
+			PropertyRecord pr;
+			std::memset(&pr, 0, sizeof(PropertyRecord));
+			pr.m_key = addString(it.key());
+			pr.m_value = addString(it.value().toString());
+			pr.m_type = it.value().userType();
+			properties.append(pr);
+		}
+		BlockHandle h = m_blocks.handle(i);
+		if ((int)h.m_index >= blockPositions.count())
+			blockPositions.resize((int)h.m_index + 1);
+		blockPositions[(int)h.m_index] = (quint32)i;
+	}
+
+	// connectors and their segments
+	QVector<ConnectorRecord> connectors;
+	QVector<SegmentRecord> segments;
+	connectors.reserve((int)m_connectors.size());
+	for (const Connector & con : m_connectors) {
+		ConnectorRecord cr;
+		std::memset(&cr, 0, sizeof(ConnectorRecord));
+		cr.m_name = addString(con.m_name);
+		cr.m_text = addString(con.m_text);
+		cr.m_color = con.m_color.rgba();
+		cr.m_linewidth = con.m_linewidth;
+		// resolved sockets are stored by index, all others by flat name
+		if (con.m_sourceSocket.isEmpty() && con.m_source.isValid() && m_blocks.contains(con.m_source.m_block)) {
+			cr.m_sourceBlock = blockPositions[(int)con.m_source.m_block.m_index];
+			cr.m_sourceSocket = (quint32)con.m_source.m_socketIdx;
+		}
+		else {
+			cr.m_flags |= CF_SourceFlatName;
+			cr.m_sourceBlock = addString(con.m_sourceSocket);
+		}
+		if (con.m_targetSocket.isEmpty() && con.m_target.isValid() && m_blocks.contains(con.m_target.m_block)) {
+			cr.m_targetBlock = blockPositions[(int)con.m_target.m_block.m_index];
+			cr.m_targetSocket = (quint32)con.m_target.m_socketIdx;
+		}
+		else {
+			cr.m_flags |= CF_TargetFlatName;
+			cr.m_targetBlock = addString(con.m_targetSocket);
+		}
+		cr.m_firstSegment = (quint32)segments.count();
+		cr.m_segmentCount = (quint32)con.m_segments.count();
+		connectors.append(cr);
+		for (const Connector::Segment & seg : con.m_segments) {
+			SegmentRecord sr;
+			std::memset(&sr, 0, sizeof(SegmentRecord));
+			sr.m_direction = (quint32)seg.m_direction;
+			sr.m_offset = seg.m_offset;
+			segments.append(sr);
+		}
+	}
+
+	// compute section offsets
+	FileHeader header;
+	std::memset(&header, 0, sizeof(FileHeader));
+	header.m_magic = MAGIC;
+	header.m_byteOrderMark = BYTE_ORDER_MARK;
+	header.m_version = VERSION;
+	header.m_stringCount = (quint32)stringTable.count() - 1;
+	header.m_blockCount = (quint32)blocks.count();
+	header.m_socketCount = (quint32)sockets.count();
+	header.m_propertyCount = (quint32)properties.count();
+	header.m_connectorCount = (quint32)connectors.count();
+	header.m_segmentCount = (quint32)segments.count();
+	quint64 offset = alignedSectionSize(sizeof(FileHeader));
+	header.m_stringTableOffset = offset;
+	offset += alignedSectionSize((quint64)stringTable.count()*sizeof(quint32));
+	header.m_stringDataOffset = offset;
+	offset += alignedSectionSize((quint64)stringData.size()*sizeof(ushort));
+	header.m_blockOffset = offset;
+	offset += alignedSectionSize((quint64)blocks.count()*sizeof(BlockRecord));
+	header.m_socketOffset = offset;
+	offset += alignedSectionSize((quint64)sockets.count()*sizeof(SocketRecord));
+	header.m_propertyOffset = offset;
+	offset += alignedSectionSize((quint64)properties.count()*sizeof(PropertyRecord));
+	header.m_connectorOffset = offset;
+	offset += alignedSectionSize((quint64)connectors.count()*sizeof(ConnectorRecord));
+	header.m_segmentOffset = offset;
+	offset += alignedSectionSize((quint64)segments.count()*sizeof(SegmentRecord));
+	header.m_fileSize = offset;
+
+	// write all sections en bloc
+	QFile file(fname);
+	if (!file.open(QIODevice::WriteOnly | QFile::Truncate))
+		throw std::runtime_error("Cannot create output file.");
+	writeBinarySection(file, &header, sizeof(FileHeader));
+	writeBinarySection(file, stringTable.constData(), (quint64)stringTable.count()*sizeof(quint32));
+	writeBinarySection(file, stringData.constData(), (quint64)stringData.size()*sizeof(ushort));
+	writeBinarySection(file, blocks.constData(), (quint64)blocks.count()*sizeof(BlockRecord));
+	writeBinarySection(file, sockets.constData(), (quint64)sockets.count()*sizeof(SocketRecord));
+	writeBinarySection(file, properties.constData(), (quint64)properties.count()*sizeof(PropertyRecord));
+	writeBinarySection(file, connectors.constData(), (quint64)connectors.count()*sizeof(ConnectorRecord));
+	writeBinarySection(file, segments.constData(), (quint64)segments.count()*sizeof(SegmentRecord));
+}
+
+
+
+/*! Returns the flat name of the connector's source or target socket for error messages.
+	Resolved connectors have no flat names anymore, and their socket handles may be stale.
+*/
+static QString socketNameForError(const Network & network, const Connector & con, bool source) {
+	try {
+		return source ? network.sourceSocketName(con) : network.targetSocketName(con);
+	} catch (...) {
+		return QString("<invalid socket handle>");
+	}
+}
+
 
 void Network::checkNames(bool printNames) const {
 	QSet<QString> blockNames;
@@ -171,49 +707,106 @@ void Network::checkNames(bool printNames) const {
 		}
 	}
 	// check all connections for valid socket names
-	QSet<QString> connectedSockets;
+	QSet<const Socket*> connectedSockets;
 	for (const Connector & con : m_connectors) {
 		// first check, that indeed the source/target connectors are valid
 		const Block * b1, * b2;
 		const Socket * s1, * s2;
 		try {
-			lookupBlockAndSocket(con.m_sourceSocket, b1, s1);
+			lookupSourceSocket(con, b1, s1);
 		} catch (...) {
-			throw std::runtime_error("Invalid source socket identifyer '"+con.m_sourceSocket.toStdString()+"'.");
+			throw std::runtime_error("Invalid source socket identifyer '"+socketNameForError(*this, con, true).toStdString()+"'.");
 		}
 		try {
-			lookupBlockAndSocket(con.m_targetSocket, b2, s2);
+			lookupTargetSocket(con, b2, s2);
 		} catch (...) {
-			throw std::runtime_error("Invalid target socket identifyer '"+con.m_targetSocket.toStdString()+"'.");
+			throw std::runtime_error("Invalid target socket identifyer '"+socketNameForError(*this, con, false).toStdString()+"'.");
 		}
 		if (s1->m_inlet)
-			throw std::runtime_error("Invalid source socket '"+con.m_sourceSocket.toStdString()+"'(must be an outlet socket).");
+			throw std::runtime_error("Invalid source socket '"+sourceSocketName(con).toStdString()+"'(must be an outlet socket).");
 		if (!s2->m_inlet)
-			throw std::runtime_error("Invalid target socket '"+con.m_targetSocket.toStdString()+"' (must be an inlet socket).");
-		if (connectedSockets.contains(con.m_targetSocket))
-			throw std::runtime_error("Target socket '"+con.m_targetSocket.toStdString()+"' connected twice!");
-		connectedSockets.insert(con.m_targetSocket);
+			throw std::runtime_error("Invalid target socket '"+targetSocketName(con).toStdString()+"' (must be an inlet socket).");
+		if (connectedSockets.contains(s2))
+			throw std::runtime_error("Target socket '"+targetSocketName(con).toStdString()+"' connected twice!");
+		connectedSockets.insert(s2);
 	}
 }
 
 
-bool Network::haveSocket(const QString & socketVariableName, bool inletSocket) const {
-	QString blockName, socketName;
-	splitFlatName(socketVariableName, blockName, socketName);
-	for (const BLOCKMOD::Block & b : m_blocks) {
-		if (b.m_name == blockName) {
-			for (const BLOCKMOD::Socket & s : b.m_sockets) {
-				if (s.m_name == socketName && (s.m_inlet == inletSocket)) {
-					return true;
-				}
-			}
+NetworkSnapshot Network::snapshot() const {
+	NetworkSnapshot s;
+	for (unsigned int i=0; i<m_blocks.size(); ++i) {
+		const Block & b = m_blocks[i];
+		if (b.m_connectionHelperBlock)
+			continue;
+		BlockHandle h = m_blocks.handle(i);
+		s.m_blockOrder.append(h);
+		s.m_blocks.insert(h, QSharedPointer<const Block>(new Block(b)));
+	}
+	for (unsigned int i=0; i<m_connectors.size(); ++i) {
+		const Connector & con = m_connectors[i];
+		if (con.m_name == Globals::InvisibleLabel)
+			continue;
+		ConnectorHandle h = m_connectors.handle(i);
+		s.m_connectorOrder.append(h);
+		s.m_connectors.insert(h, QSharedPointer<const Connector>(new Connector(con)));
+	}
+	return s;
+}
+
+
+NetworkSnapshot Network::snapshot(const NetworkSnapshot & previous, const QSet<BlockHandle> & changedBlocks,
+								  const QSet<ConnectorHandle> & changedConnectors, bool orderChanged) const
+{
+	// only the pages holding changed blocks and connectors are copied, all others remain shared
+	NetworkSnapshot s(previous);
+	for (const BlockHandle & h : changedBlocks) {
+		const Block * b = m_blocks.get(h);
+		if (b == nullptr || b->m_connectionHelperBlock)
+			s.m_blocks.remove(h);
+		else
+			s.m_blocks.insert(h, QSharedPointer<const Block>(new Block(*b)));
+	}
+	for (const ConnectorHandle & h : changedConnectors) {
+		const Connector * con = m_connectors.get(h);
+		if (con == nullptr || con->m_name == Globals::InvisibleLabel)
+			s.m_connectors.remove(h);
+		else
+			s.m_connectors.insert(h, QSharedPointer<const Connector>(new Connector(*con)));
+	}
+	if (orderChanged) {
+		s.m_blockOrder.clear();
+		for (unsigned int i=0; i<m_blocks.size(); ++i) {
+			BlockHandle h = m_blocks.handle(i);
+			if (s.m_blocks.get(h) != nullptr)
+				s.m_blockOrder.append(h);
+		}
+		s.m_connectorOrder.clear();
+		for (unsigned int i=0; i<m_connectors.size(); ++i) {
+			ConnectorHandle h = m_connectors.handle(i);
+			if (s.m_connectors.get(h) != nullptr)
+				s.m_connectorOrder.append(h);
 		}
 	}
-	return false;
+	return s;
+}
+
+
+bool Network::haveSocket(const QString & socketVariableName, bool inletSocket) const {
+	const Block * block;
+	const Socket * socket;
+	try {
+		lookupBlockAndSocket(socketVariableName, block, socket);
+	} catch (...) {
+		return false;
+	}
+	return socket->m_inlet == inletSocket;
 }
 
 
 void Network::adjustConnectors() {
+	// all connectors change, rebuilding the index on next query is cheaper than updating each connector
+	resetConnectorGrid();
 	for (Connector & c : m_connectors) {
 		try {
 			adjustConnector(c);
@@ -227,13 +820,14 @@ void Network::adjustConnectors() {
 
 
 void Network::adjustConnector(Connector & con) {
-	// split socket name into block and socket
+	// replace flat names by socket handles, if not yet done
+	resolveConnector(con);
 	const Socket * socket;
 	const Block * block;
-	lookupBlockAndSocket(con.m_sourceSocket, block, socket);
+	lookupBlockAndSocket(con.m_source, block, socket);
 	// get start coordinates: first point is the socket's center, second point is the connection point outside the socket
 	QLineF startLine = block->socketStartLine(socket);
-	lookupBlockAndSocket(con.m_targetSocket, block, socket);
+	lookupBlockAndSocket(con.m_target, block, socket);
 	// get start coordinates: first point is the socket's center, second point is the connection point outside the socket
 	QLineF endLine = block->socketStartLine(socket);
 
@@ -284,81 +878,506 @@ void Network::adjustConnector(Connector & con) {
 			con.m_segments.append(s);
 		}
 	}
+	// keep spatial index in sync, unless it is not built yet
+	if (m_gridConnectorCount > 0)
+		connectorGeometryChanged(connectorHandle(&con));
+}
+
+
+void Network::resolveConnector(Connector & con) const {
+	if (con.m_sourceSocket.isEmpty() && con.m_targetSocket.isEmpty())
+		return; // already resolved
+	SocketHandle source = con.m_source;
+	SocketHandle target = con.m_target;
+	BlockHandle block;
+	int socketIdx;
+	if (!con.m_sourceSocket.isEmpty()) {
+		try {
+			lookupSocketIndex(con.m_sourceSocket, block, socketIdx);
+		} catch (...) {
+			throw std::runtime_error("Invalid source socket identifyer '"+con.m_sourceSocket.toStdString()+"'.");
+		}
+		source = SocketHandle(block, socketIdx);
+	}
+	if (!con.m_targetSocket.isEmpty()) {
+		try {
+			lookupSocketIndex(con.m_targetSocket, block, socketIdx);
+		} catch (...) {
+			throw std::runtime_error("Invalid target socket identifyer '"+con.m_targetSocket.toStdString()+"'.");
+		}
+		target = SocketHandle(block, socketIdx);
+	}
+	con.m_source = source;
+	con.m_target = target;
+	con.m_sourceSocket.clear();
+	con.m_targetSocket.clear();
+}
+
+
+void Network::resolveConnectors() {
+	// connectors erased directly from m_connectors -> process all connectors
+	if (m_resolveEraseCount != m_connectors.eraseCount() || m_resolvedConnectorCount > m_connectors.size()) {
+		m_resolvedConnectorCount = 0;
+		m_unresolvedConnectors.clear();
+		m_resolveEraseCount = m_connectors.eraseCount();
+	}
+	bool resolved = false;
+	// blocks may have been added or renamed since, so retry connectors that could not be resolved before
+	for (QSet<ConnectorHandle>::iterator it = m_unresolvedConnectors.begin(); it != m_unresolvedConnectors.end();) {
+		Connector * con = m_connectors.get(*it);
+		try {
+			if (con != nullptr)
+				resolveConnector(*con);
+			it = m_unresolvedConnectors.erase(it);
+			resolved = true;
+		} catch (...) {
+			++it; // keep flat names of invalid connectors
+		}
+	}
+	// connectors are always appended to the list, so we only need to process the last connectors
+	for (size_t i=m_resolvedConnectorCount; i<m_connectors.size(); ++i) {
+		Connector & con = m_connectors[i];
+		if (con.m_sourceSocket.isEmpty() && con.m_targetSocket.isEmpty())
+			continue;
+		try {
+			resolveConnector(con);
+			// connector may have been skipped by the adjacency index, because it was invalid at that time
+			if (i < m_adjacencyConnectorCount)
+				resolved = true;
+		} catch (...) {
+			m_unresolvedConnectors.insert(m_connectors.handle(i));
+		}
+	}
+	m_resolvedConnectorCount = m_connectors.size();
+	// connectors that could not be resolved when they were indexed may be valid now
+	if (resolved)
+		resetAdjacencyIndex();
+}
+
+
+void Network::unresolveConnectors() {
+	// sockets may be modified after this call, so the adjacency and lookup indexes must be rebuilt
+	resetAdjacencyIndex();
+	resetLookupIndex();
+	// all connectors get flat names and must be processed again by resolveConnectors()
+	m_resolvedConnectorCount = 0;
+	m_unresolvedConnectors.clear();
+	for (Connector & con : m_connectors) {
+		if (con.m_sourceSocket.isEmpty() && con.m_source.isValid())
+			con.m_sourceSocket = socketFlatName(con.m_source);
+		if (con.m_targetSocket.isEmpty() && con.m_target.isValid())
+			con.m_targetSocket = socketFlatName(con.m_target);
+	}
+}
+
+
+QString Network::socketFlatName(const SocketHandle & socketHandle) const {
+	const Block * block;
+	const Socket * socket;
+	lookupBlockAndSocket(socketHandle, block, socket);
+	return block->m_name + "." + socket->m_name;
+}
+
+
+QString Network::sourceSocketName(const Connector & con) const {
+	if (!con.m_sourceSocket.isEmpty() || !con.m_source.isValid())
+		return con.m_sourceSocket;
+	return socketFlatName(con.m_source);
+}
+
+
+QString Network::targetSocketName(const Connector & con) const {
+	if (!con.m_targetSocket.isEmpty() || !con.m_target.isValid())
+		return con.m_targetSocket;
+	return socketFlatName(con.m_target);
 }
 
 
 void Network::lookupBlockAndSocket(const QString & flatName, const Block *& block, const Socket * &socket) const {
-	QString blockName, socketName;
-	splitFlatName(flatName, blockName, socketName);
-	// search block by name
-	auto blockIt = std::find_if(m_blocks.begin(), m_blocks.end(),
-								[&] (const Block& b) { return b.m_name == blockName; } );
-	if (blockIt == m_blocks.end())
-		throw std::runtime_error("Invalid flat name.");
+	BlockHandle bh;
+	int socketIdx;
+	lookupSocketIndex(flatName, bh, socketIdx);
+	block = m_blocks.get(bh);
+	socket = &block->m_sockets.at(socketIdx);
+}
 
-	const Block & b = *blockIt;
-	block = &b;
 
-	// search socket by name
-	auto socketIt = std::find_if(b.m_sockets.constBegin(), b.m_sockets.constEnd(),
-								[&] (const Socket& s) { return s.m_name == socketName; } );
-	if (socketIt == b.m_sockets.constEnd())
-		throw std::runtime_error("Invalid flat name.");
+void Network::lookupBlockAndSocket(const SocketHandle & socketHandle, const Block *& block, const Socket *& socket) const {
+	const Block * b = m_blocks.get(socketHandle.m_block);
+	if (b == nullptr || socketHandle.m_socketIdx < 0 || socketHandle.m_socketIdx >= b->m_sockets.count())
+		throw std::runtime_error("Invalid socket handle.");
+	block = b;
+	socket = &b->m_sockets.at(socketHandle.m_socketIdx);
+}
+
 
-	const Socket & s = *socketIt;
-	socket = &s;
+void Network::lookupSourceSocket(const Connector & con, const Block *& block, const Socket *& socket) const {
+	if (!con.m_sourceSocket.isEmpty())
+		lookupBlockAndSocket(con.m_sourceSocket, block, socket);
+	else
+		lookupBlockAndSocket(con.m_source, block, socket);
 }
 
 
-void Network::removeBlock(unsigned int blockIdx) {
-	Q_ASSERT(blockIdx < static_cast<unsigned int>(m_blocks.size()));
+void Network::lookupTargetSocket(const Connector & con, const Block *& block, const Socket *& socket) const {
+	if (!con.m_targetSocket.isEmpty())
+		lookupBlockAndSocket(con.m_targetSocket, block, socket);
+	else
+		lookupBlockAndSocket(con.m_target, block, socket);
+}
 
-	// get block ID name
-	auto bit = m_blocks.begin(); std::advance(bit, blockIdx);
-	QString bName = bit->m_name;
-
-	// erase all connectors that refer to this block
-	auto cit = m_connectors.begin();
-	while (cit != m_connectors.end()) {
-		QString blockName, socketName;
-		splitFlatName(cit->m_sourceSocket, blockName, socketName);
-		if (blockName == bName) {
-			auto cit2 = cit;
-			++cit2;
-			m_connectors.erase(cit);
-			cit = cit2;
-			continue;
+
+const Block * Network::blockByName(const QString & blockName) const {
+	updateLookupIndex();
+	QHash<QString, BlockHandle>::const_iterator it = m_blockIndex.constFind(blockName);
+	if (it == m_blockIndex.constEnd())
+		return nullptr; // unknown name
+	const Block * b = m_blocks.get(it.value());
+	if (b != nullptr && b->m_name == blockName)
+		return b;
+	// block may have been renamed or removed directly, rebuild index and try again
+	resetLookupIndex();
+	updateLookupIndex();
+	return m_blocks.get(m_blockIndex.value(blockName));
+}
+
+
+BlockHandle Network::blockHandle(const Block * block) const {
+	return m_blocks.handleOf(block);
+}
+
+
+ConnectorHandle Network::connectorHandle(const Connector * con) const {
+	return m_connectors.handleOf(con);
+}
+
+
+SocketHandle Network::socketHandle(const Block * block, const Socket * socket) const {
+	BlockHandle bh = m_blocks.handleOf(block);
+	if (!bh.isValid())
+		return SocketHandle();
+	for (int i=0; i<block->m_sockets.count(); ++i) {
+		if (&block->m_sockets.at(i) == socket)
+			return SocketHandle(bh, i);
+	}
+	return SocketHandle();
+}
+
+
+ConnectorHandle Network::incomingConnector(const SocketHandle & inletSocket) const {
+	updateAdjacencyIndex();
+	return m_incomingConnectors.value(inletSocket);
+}
+
+
+QList<ConnectorHandle> Network::outgoingConnectors(const SocketHandle & outletSocket) const {
+	updateAdjacencyIndex();
+	return m_outgoingConnectors.value(outletSocket);
+}
+
+
+QList<ConnectorHandle> Network::blockConnectors(const BlockHandle & block) const {
+	updateAdjacencyIndex();
+	return m_blockConnectors.value(block);
+}
+
+
+bool Network::isConnectedSocket(const SocketHandle & socket) const {
+	updateAdjacencyIndex();
+	return m_incomingConnectors.contains(socket) || m_outgoingConnectors.contains(socket);
+}
+
+
+/*! Returns true, if both rects overlap or touch. Unlike QRectF::intersects(), this also works
+	for rects with zero width or height (e.g. bounding rects of straight connectors).
+*/
+static bool rectsOverlap(const QRectF & a, const QRectF & b) {
+	return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+
+QRectF Network::connectorBoundingRect(const Connector & con) const {
+	QVector<QPointF> points;
+	connectorPolyline(con, points);
+	double left = points[0].x();
+	double right = left;
+	double top = points[0].y();
+	double bottom = top;
+	for (const QPointF & p : points) {
+		left = std::min(left, p.x());
+		right = std::max(right, p.x());
+		top = std::min(top, p.y());
+		bottom = std::max(bottom, p.y());
+	}
+	return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+
+QList<BlockHandle> Network::blocksInRect(const QRectF & rect) const {
+	updateSpatialIndex();
+	QVector<BlockHandle> candidates;
+	m_blockGrid.query(rect, candidates);
+	QList<BlockHandle> handles;
+	for (const BlockHandle & h : qAsConst(candidates)) {
+		const Block * b = m_blocks.get(h);
+		if (rectsOverlap(QRectF(b->m_pos, b->m_size), rect))
+			handles.append(h);
+	}
+	return handles;
+}
+
+
+QList<ConnectorHandle> Network::connectorsInRect(const QRectF & rect) const {
+	updateSpatialIndex();
+	QVector<ConnectorHandle> candidates;
+	m_connectorGrid.query(rect, candidates);
+	QList<ConnectorHandle> handles;
+	QVector<QPointF> points;
+	for (const ConnectorHandle & h : qAsConst(candidates)) {
+		try {
+			connectorPolyline(*m_connectors.get(h), points);
+		}
+		catch (...) {
+			continue; // connector became unresolvable
 		}
-		splitFlatName(cit->m_targetSocket, blockName, socketName);
-		if (blockName == bName) {
-			auto cit2 = cit;
-			++cit2;
-			m_connectors.erase(cit);
-			cit = cit2;
+		// all lines are parallel to the axes, so we can test their bounding rects
+		for (int i=1; i<points.count(); ++i) {
+			if (rectsOverlap(QRectF(points[i-1], points[i]).normalized(), rect)) {
+				handles.append(h);
+				break;
+			}
+		}
+	}
+	return handles;
+}
+
+
+SocketHandle Network::nearestSocket(const QPointF & pos, double maxDistance, bool inlet) const {
+	// sockets are located on the block boundary, so all candidate blocks intersect the search rect
+	QRectF searchRect(pos.x() - maxDistance, pos.y() - maxDistance, 2*maxDistance, 2*maxDistance);
+	SocketHandle nearest;
+	double nearestDistance = maxDistance;
+	const QList<BlockHandle> blocks = blocksInRect(searchRect);
+	for (const BlockHandle & h : blocks) {
+		const Block * b = m_blocks.get(h);
+		if (b->m_connectionHelperBlock)
 			continue;
+		for (int i=0; i<b->m_sockets.count(); ++i) {
+			const Socket & s = b->m_sockets[i];
+			if (s.m_inlet != inlet)
+				continue;
+			double d = (b->m_pos + s.m_pos - pos).manhattanLength();
+			if (d < nearestDistance) {
+				nearestDistance = d;
+				nearest = SocketHandle(h, i);
+			}
 		}
-		++cit;
 	}
-	m_blocks.erase(bit);
+	return nearest;
 }
 
 
-void Network::renameBlock(unsigned int blockIdx, const QString &newName) {
-	auto bit = m_blocks.begin(); std::advance(bit, blockIdx);
-	QString oldName = bit->m_name;
-	bit->m_name = newName;
+void Network::blockGeometryChanged(const BlockHandle & block) {
+	// nothing to do if block grid is not built yet or will be rebuilt anyway
+	if (m_gridBlockCount == 0 || m_gridBlockEraseCount != m_blocks.eraseCount())
+		return;
+	// blocks appended since the last update are indexed with their current geometry on next query
+	const Block * b = m_blocks.get(block);
+	if (b != nullptr && m_blockGrid.contains(block))
+		m_blockGrid.update(block, QRectF(b->m_pos, b->m_size));
+}
 
-	for (Connector & c : m_connectors) {
-		QString blockName, socketName;
-		splitFlatName(c.m_sourceSocket, blockName, socketName);
-		if (blockName == oldName) {
-			c.m_sourceSocket = newName + "." + socketName;
-		}
-		splitFlatName(c.m_targetSocket, blockName, socketName);
-		if (blockName == oldName) {
-			c.m_targetSocket = newName + "." + socketName;
+
+void Network::connectorGeometryChanged(const ConnectorHandle & connector) {
+	if (m_gridConnectorCount == 0 || m_gridConnectorEraseCount != m_connectors.eraseCount())
+		return;
+	// connectors appended since the last update are indexed with their current geometry on next query
+	const Connector * con = m_connectors.get(connector);
+	if (con == nullptr || !m_connectorGrid.contains(connector))
+		return;
+	m_connectorGrid.remove(connector);
+	addToConnectorGrid(*con, connector);
+}
+
+
+void Network::invalidateSpatialIndex() {
+	resetBlockGrid();
+	resetConnectorGrid();
+}
+
+
+void Network::checkConnector(const Connector & con, const ConnectorHandle & handle) const {
+	const Block * b1, * b2;
+	const Socket * s1, * s2;
+	try {
+		lookupSourceSocket(con, b1, s1);
+	} catch (...) {
+		throw std::runtime_error("Invalid source socket identifyer.");
+	}
+	try {
+		lookupTargetSocket(con, b2, s2);
+	} catch (...) {
+		throw std::runtime_error("Invalid target socket identifyer.");
+	}
+	if (s1->m_inlet)
+		throw std::runtime_error("Invalid source socket (must be an outlet socket).");
+	if (!s2->m_inlet)
+		throw std::runtime_error("Invalid target socket (must be an inlet socket).");
+	// check, if inlet socket is already connected to by another connector
+	ConnectorHandle incoming = incomingConnector(socketHandle(b2, s2));
+	if (incoming.isValid() && incoming != handle)
+		throw std::runtime_error("Invalid target socket (has already an incoming connection).");
+}
+
+
+ConnectorHandle Network::addConnector(const Connector & con) {
+	ConnectorHandle handle = m_connectors.push_back(con);
+	try {
+		resolveConnector(*m_connectors.get(handle));
+	} catch (...) {
+		// keep flat names of invalid connectors
+	}
+	updateAdjacencyIndex(); // indexes the new connector
+	return handle;
+}
+
+
+void Network::removeConnector(const ConnectorHandle & handle) {
+	const Connector * con = m_connectors.get(handle);
+	if (con == nullptr)
+		throw std::runtime_error("Invalid connector handle.");
+	updateAdjacencyIndex();
+	removeFromAdjacencyIndex(*con, handle);
+	// keep the connector grid if it is in sync, otherwise it is rebuilt on next query anyway
+	bool gridInSync = m_gridConnectorCount == m_connectors.size() && m_gridConnectorEraseCount == m_connectors.eraseCount();
+	if (gridInSync)
+		m_connectorGrid.remove(handle);
+	bool resolveInSync = m_resolvedConnectorCount == m_connectors.size() && m_resolveEraseCount == m_connectors.eraseCount();
+	m_connectors.erase(handle);
+	--m_adjacencyConnectorCount;
+	m_adjacencyEraseCount = m_connectors.eraseCount();
+	if (resolveInSync) {
+		m_unresolvedConnectors.remove(handle);
+		m_resolvedConnectorCount = m_connectors.size();
+		m_resolveEraseCount = m_connectors.eraseCount();
+	}
+	if (gridInSync) {
+		m_gridConnectorCount = m_connectors.size();
+		m_gridConnectorEraseCount = m_connectors.eraseCount();
+	}
+}
+
+
+void Network::invalidateLookupIndex() {
+	resetLookupIndex();
+}
+
+
+void Network::removeBlock(unsigned int blockIdx) {
+	Q_ASSERT(blockIdx < static_cast<unsigned int>(m_blocks.size()));
+	removeBlock(m_blocks.handle(blockIdx));
+}
+
+
+void Network::removeBlock(const BlockHandle & handle) {
+	removeBlocks(QList<BlockHandle>() << handle);
+}
+
+
+void Network::removeBlocks(const QList<BlockHandle> & handles) {
+	QSet<const Block*> removedBlocks;
+	for (const BlockHandle & h : handles) {
+		const Block * b = m_blocks.get(h);
+		if (b == nullptr)
+			throw std::runtime_error("Invalid block handle.");
+		removedBlocks.insert(b);
+	}
+
+	updateLookupIndex();
+	// connectors that still reference sockets by flat name must be resolved so that they are found in the
+	// adjacency index (only processes new and previously unresolved connectors)
+	resolveConnectors();
+	updateAdjacencyIndex();
+
+	// spatial index parts that are in sync are updated, all others are rebuilt on next query anyway
+	bool blockGridInSync = m_gridBlockCount == m_blocks.size() && m_gridBlockEraseCount == m_blocks.eraseCount();
+	bool connectorGridInSync = m_gridConnectorCount == m_connectors.size() && m_gridConnectorEraseCount == m_connectors.eraseCount();
+
+	// remove all connectors that refer to the removed blocks from the adjacency index
+	QSet<ConnectorHandle> removedConnectors;
+	for (const BlockHandle & h : handles) {
+		const QList<ConnectorHandle> cons = m_blockConnectors.value(h);
+		for (const ConnectorHandle & ch : cons) {
+			if (removedConnectors.contains(ch))
+				continue; // connects two removed blocks
+			removedConnectors.insert(ch);
+			removeFromAdjacencyIndex(*m_connectors.get(ch), ch);
+			if (connectorGridInSync)
+				m_connectorGrid.remove(ch);
 		}
 	}
+	// erase attached connectors by handle, many connectors in a single pass
+	if (removedConnectors.count() <= Globals::SmallRemovalCount) {
+		for (const ConnectorHandle & ch : qAsConst(removedConnectors))
+			m_connectors.erase(ch);
+	}
+	else {
+		m_connectors.removeIf([&removedBlocks, this](const Connector & con) {
+			return removedBlocks.contains(m_blocks.get(con.m_source.m_block)) ||
+					removedBlocks.contains(m_blocks.get(con.m_target.m_block));
+		});
+	}
+	m_adjacencyConnectorCount = m_connectors.size();
+	m_adjacencyEraseCount = m_connectors.eraseCount();
+	// resolveConnectors() was called above, and only resolved connectors (from the adjacency index) have been removed
+	m_resolvedConnectorCount = m_connectors.size();
+	m_resolveEraseCount = m_connectors.eraseCount();
+	if (connectorGridInSync) {
+		m_gridConnectorCount = m_connectors.size();
+		m_gridConnectorEraseCount = m_connectors.eraseCount();
+	}
+
+	for (const Block * b : removedBlocks)
+		removeFromLookupIndex(*b);
+	if (blockGridInSync) {
+		for (const BlockHandle & h : handles)
+			m_blockGrid.remove(h);
+	}
+	if (handles.count() <= Globals::SmallRemovalCount) {
+		for (const BlockHandle & h : handles)
+			m_blocks.erase(h);
+	}
+	else {
+		m_blocks.removeIf([&removedBlocks](const Block & b) {
+			return removedBlocks.contains(&b);
+		});
+	}
+	m_indexedBlockCount = m_blocks.size();
+	if (blockGridInSync) {
+		m_gridBlockCount = m_blocks.size();
+		m_gridBlockEraseCount = m_blocks.eraseCount();
+	}
+}
+
+
+void Network::renameBlock(unsigned int blockIdx, const QString &newName) {
+	Q_ASSERT(blockIdx < static_cast<unsigned int>(m_blocks.size()));
+	renameBlock(m_blocks.handle(blockIdx), newName);
+}
+
+
+void Network::renameBlock(const BlockHandle & handle, const QString & newName) {
+	Block * b = m_blocks.get(handle);
+	if (b == nullptr)
+		throw std::runtime_error("Invalid block handle.");
+	updateLookupIndex();
+	// connectors that still reference the block by its old name must be resolved first
+	// (only processes new and previously unresolved connectors)
+	resolveConnectors();
+
+	removeFromLookupIndex(*b);
+	b->m_name = newName;
+	addToLookupIndex(*b, handle);
 }
 
 
@@ -371,4 +1390,259 @@ void Network::splitFlatName(const QString & flatVariableName, QString & blockNam
 }
 
 
+// *** private functions ***
+
+void Network::updateLookupIndex() const {
+	if (m_indexedBlockCount == m_blocks.size())
+		return;
+	if (m_indexedBlockCount > m_blocks.size()) {
+		// blocks have been removed from list directly, rebuild index
+		resetLookupIndex();
+	}
+	// blocks are always appended to the list, so we only need to index the last blocks
+	for (size_t i=m_indexedBlockCount; i<m_blocks.size(); ++i)
+		addToLookupIndex(m_blocks[i], m_blocks.handle(i));
+	m_indexedBlockCount = m_blocks.size();
+}
+
+
+void Network::resetLookupIndex() const {
+	m_blockIndex.clear();
+	m_socketIndex.clear();
+	m_indexedBlockCount = 0;
+}
+
+
+void Network::addToLookupIndex(const Block & b, const BlockHandle & handle) const {
+	m_blockIndex[b.m_name] = handle;
+	for (int i=0; i<b.m_sockets.count(); ++i)
+		m_socketIndex[b.m_name + "." + b.m_sockets.at(i).m_name] = qMakePair(handle, i);
+}
+
+
+void Network::removeFromLookupIndex(const Block & b) const {
+	QHash<QString, BlockHandle>::iterator it = m_blockIndex.find(b.m_name);
+	if (it != m_blockIndex.end() && m_blocks.get(it.value()) == &b)
+		m_blockIndex.erase(it);
+	for (const Socket & s : b.m_sockets) {
+		QHash<QString, QPair<BlockHandle, int> >::iterator sit = m_socketIndex.find(b.m_name + "." + s.m_name);
+		if (sit != m_socketIndex.end() && m_blocks.get(sit.value().first) == &b)
+			m_socketIndex.erase(sit);
+	}
+}
+
+
+bool Network::findInLookupIndex(const QString & flatName, BlockHandle & block, int & socketIdx, bool & outdated) const {
+	QHash<QString, QPair<BlockHandle, int> >::const_iterator it = m_socketIndex.constFind(flatName);
+	if (it == m_socketIndex.constEnd())
+		return false;
+	// entry exists, but may not match the data structure anymore
+	outdated = true;
+	// block may have been removed from the network directly (stale handle)
+	const Block * b = m_blocks.get(it.value().first);
+	if (b == nullptr)
+		return false;
+	int idx = it.value().second;
+	if (idx >= b->m_sockets.count())
+		return false;
+	// check that names still match the key - compare without creating temporary strings
+	const Socket & s = b->m_sockets.at(idx);
+	int len = b->m_name.length();
+	if (flatName.length() != len + 1 + s.m_name.length() ||
+		flatName.leftRef(len) != b->m_name ||
+		flatName.midRef(len+1) != s.m_name)
+	{
+		return false;
+	}
+	block = it.value().first;
+	socketIdx = idx;
+	outdated = false;
+	return true;
+}
+
+
+void Network::lookupSocketIndex(const QString & flatName, BlockHandle & block, int & socketIdx) const {
+	updateLookupIndex();
+	bool outdated = false;
+	// fast path: flat name is used directly as key, no string splitting needed
+	if (findInLookupIndex(flatName, block, socketIdx, outdated))
+		return;
+
+	// slow path: flat name may contain white spaces around the . character
+	QString blockName, socketName;
+	splitFlatName(flatName, blockName, socketName);
+	QString key = blockName + "." + socketName;
+	if (key != flatName && findInLookupIndex(key, block, socketIdx, outdated))
+		return;
+
+	// the index is only rebuilt, when an entry does not match the data structure anymore (block or socket
+	// renamed or removed directly), unknown names are reported right away
+	if (outdated) {
+		resetLookupIndex();
+		updateLookupIndex();
+		if (findInLookupIndex(key, block, socketIdx, outdated))
+			return;
+	}
+
+	throw std::runtime_error("Invalid flat name.");
+}
+
+
+void Network::updateAdjacencyIndex() const {
+	// connectors erased directly from m_connectors -> rebuild index
+	if (m_adjacencyEraseCount != m_connectors.eraseCount() || m_adjacencyConnectorCount > m_connectors.size())
+		resetAdjacencyIndex();
+	// connectors are always appended to the list, so we only need to index the last connectors
+	for (size_t i=m_adjacencyConnectorCount; i<m_connectors.size(); ++i)
+		addToAdjacencyIndex(m_connectors[i], m_connectors.handle(i));
+	m_adjacencyConnectorCount = m_connectors.size();
+}
+
+
+void Network::resetAdjacencyIndex() const {
+	m_incomingConnectors.clear();
+	m_outgoingConnectors.clear();
+	m_blockConnectors.clear();
+	m_adjacencyConnectorCount = 0;
+	m_adjacencyEraseCount = m_connectors.eraseCount();
+}
+
+
+bool Network::connectorSockets(const Connector & con, SocketHandle & source, SocketHandle & target) const {
+	source = con.m_source;
+	target = con.m_target;
+	BlockHandle block;
+	int socketIdx;
+	try {
+		if (!con.m_sourceSocket.isEmpty()) {
+			lookupSocketIndex(con.m_sourceSocket, block, socketIdx);
+			source = SocketHandle(block, socketIdx);
+		}
+		if (!con.m_targetSocket.isEmpty()) {
+			lookupSocketIndex(con.m_targetSocket, block, socketIdx);
+			target = SocketHandle(block, socketIdx);
+		}
+	} catch (...) {
+		return false;
+	}
+	return source.isValid() && target.isValid();
+}
+
+
+void Network::addToAdjacencyIndex(const Connector & con, const ConnectorHandle & handle) const {
+	SocketHandle source, target;
+	if (!connectorSockets(con, source, target))
+		return; // invalid connectors are not indexed
+	m_outgoingConnectors[source].append(handle);
+	// first connector wins, further connectors to the same inlet socket are invalid (see checkConnector())
+	if (!m_incomingConnectors.contains(target))
+		m_incomingConnectors.insert(target, handle);
+	m_blockConnectors[source.m_block].append(handle);
+	if (target.m_block != source.m_block)
+		m_blockConnectors[target.m_block].append(handle);
+}
+
+
+void Network::removeFromAdjacencyIndex(const Connector & con, const ConnectorHandle & handle) const {
+	SocketHandle source, target;
+	if (!connectorSockets(con, source, target))
+		return;
+	QHash<SocketHandle, QList<ConnectorHandle> >::iterator it = m_outgoingConnectors.find(source);
+	if (it != m_outgoingConnectors.end()) {
+		it.value().removeOne(handle);
+		if (it.value().isEmpty())
+			m_outgoingConnectors.erase(it);
+	}
+	QHash<SocketHandle, ConnectorHandle>::iterator iit = m_incomingConnectors.find(target);
+	if (iit != m_incomingConnectors.end() && iit.value() == handle) {
+		m_incomingConnectors.erase(iit);
+		// another (invalid) connector may end in the same inlet socket, it becomes the incoming connector now
+		const QList<ConnectorHandle> & targetCons = m_blockConnectors.value(target.m_block);
+		for (const ConnectorHandle & ch : targetCons) {
+			SocketHandle s, t;
+			if (ch != handle && connectorSockets(*m_connectors.get(ch), s, t) && t == target) {
+				m_incomingConnectors.insert(target, ch);
+				break;
+			}
+		}
+	}
+	BlockHandle blocks[2] = { source.m_block, target.m_block };
+	for (const BlockHandle & bh : blocks) {
+		QHash<BlockHandle, QList<ConnectorHandle> >::iterator bit = m_blockConnectors.find(bh);
+		if (bit != m_blockConnectors.end()) {
+			bit.value().removeOne(handle);
+			if (bit.value().isEmpty())
+				m_blockConnectors.erase(bit);
+		}
+	}
+}
+
+
+void Network::connectorPolyline(const Connector & con, QVector<QPointF> & points) const {
+	points.clear();
+	const Block * block;
+	const Socket * socket;
+	lookupSourceSocket(con, block, socket);
+	QLineF startLine = block->socketStartLine(socket);
+	lookupTargetSocket(con, block, socket);
+	QLineF endLine = block->socketStartLine(socket);
+
+	points.append(startLine.p1());
+	points.append(startLine.p2());
+	QPointF p = startLine.p2();
+	for (const Connector::Segment & seg : con.m_segments) {
+		if (seg.m_direction == Qt::Horizontal)
+			p.rx() += seg.m_offset;
+		else
+			p.ry() += seg.m_offset;
+		points.append(p);
+	}
+	points.append(endLine.p2());
+	points.append(endLine.p1());
+}
+
+
+void Network::updateSpatialIndex() const {
+	// blocks or connectors erased directly -> rebuild respective grid
+	if (m_gridBlockEraseCount != m_blocks.eraseCount() || m_gridBlockCount > m_blocks.size())
+		resetBlockGrid();
+	// blocks are always appended to the list, so we only need to index the last blocks
+	for (size_t i=m_gridBlockCount; i<m_blocks.size(); ++i) {
+		const Block & b = m_blocks[i];
+		m_blockGrid.insert(m_blocks.handle(i), QRectF(b.m_pos, b.m_size));
+	}
+	m_gridBlockCount = m_blocks.size();
+
+	if (m_gridConnectorEraseCount != m_connectors.eraseCount() || m_gridConnectorCount > m_connectors.size())
+		resetConnectorGrid();
+	for (size_t i=m_gridConnectorCount; i<m_connectors.size(); ++i)
+		addToConnectorGrid(m_connectors[i], m_connectors.handle(i));
+	m_gridConnectorCount = m_connectors.size();
+}
+
+
+void Network::resetBlockGrid() const {
+	m_blockGrid.clear();
+	m_gridBlockCount = 0;
+	m_gridBlockEraseCount = m_blocks.eraseCount();
+}
+
+
+void Network::resetConnectorGrid() const {
+	m_connectorGrid.clear();
+	m_gridConnectorCount = 0;
+	m_gridConnectorEraseCount = m_connectors.eraseCount();
+}
+
+
+void Network::addToConnectorGrid(const Connector & con, const ConnectorHandle & handle) const {
+	try {
+		m_connectorGrid.insert(handle, connectorBoundingRect(con));
+	}
+	catch (...) {
+		// invalid connectors are not indexed
+	}
+}
+
+
 } // namespace BLOCKMOD
@@ -35,12 +35,19 @@
 #define BM_NetworkH
 
 #include <QList>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QRectF>
 
 #include <BM_Block.h>
 #include <BM_Socket.h>
 #include <BM_Connector.h>
+#include <BM_SpatialGrid.h>
+#include <BM_NetworkSnapshot.h>
 
 class QXmlStreamReader;
+class QIODevice;
 
 namespace BLOCKMOD {
 
@@ -59,8 +66,33 @@ public:
 
 	/*! Reads network from file. */
 	void readXML(const QString & fname);
+	/*! Reads network from an opened device, for example a file wrapper that reports the reading progress. */
+	void readXML(QIODevice & device);
+	/*! Reads network from file and returns it by value (moved, not copied, into the target).
+		Use together with SceneManager::setNetwork(Network&&) to load a file without copying network data.
+	*/
+	static Network fromXML(const QString & fname);
+	/*! Reads network from file, parsing the Blocks and Connectors sections in parallel.
+		The raw file content is scanned for the child elements of both sections, which are then split into
+		chunks and parsed with separate XML stream readers on the global thread pool. The objects are appended
+		in original order, so the result is identical to readXML().
+		If the document cannot be split safely (see scanXMLSections()) or contains errors, the file is read
+		with readXML() instead, so that also error messages are identical.
+	*/
+	void readXMLParallel(const QString & fname);
 	/*! Writes network to file. */
 	void writeXML(const QString & fname) const;
+
+	/*! Reads network from a file in binary format (*.bmb), see BinaryFormat for a description of the format.
+		The file is memory-mapped and all records are read directly from the mapped data.
+	*/
+	void readBinary(const QString & fname);
+	/*! Reads network from binary file and returns it by value (see fromXML()). */
+	static Network fromBinary(const QString & fname);
+	/*! Writes network to file in binary format (*.bmb).
+		\note The binary format is meant for fast loading/saving of large networks, use XML for exchanging networks.
+	*/
+	void writeBinary(const QString & fname) const;
 	/*! Flattens all ID names of sockets and blocks and checks for duplicates. */
 	void checkNames(bool printNames=false) const;
 
@@ -70,43 +102,228 @@ public:
 	*/
 	bool haveSocket(const QString & socketVariableName, bool inletSocket) const;
 
+	/*! Returns an immutable snapshot of the network (see NetworkSnapshot), copies all blocks and connectors.
+		Connection helper blocks and connectors are not part of the snapshot.
+	*/
+	NetworkSnapshot snapshot() const;
+
+	/*! Returns a snapshot that shares all blocks and connectors with a previous snapshot of this network, except
+		for the given blocks and connectors, which have been changed, added or removed since.
+		Cost is O(number of changes), plus copying the page table (O(n/256)) and the affected pages (see SnapshotPages).
+		When blocks or connectors have been added or removed (orderChanged is true), the order lists of the
+		snapshot are rebuilt, which is O(n).
+	*/
+	NetworkSnapshot snapshot(const NetworkSnapshot & previous, const QSet<BlockHandle> & changedBlocks,
+							 const QSet<ConnectorHandle> & changedConnectors, bool orderChanged) const;
+
 
 
 	/*! Processes all connectors and updates their segments so that start/end sockets are connected. */
 	void adjustConnectors();
 
 	/*! Processes a single connector and adjusts the connection segments.
-		Function first checks if blocks and sockets match using <block-name>.<socket-name> referencing.
+		Function first resolves the connector (if it still references sockets via <block-name>.<socket-name>),
+		hereby checking that blocks and sockets exist.
 	*/
 	void adjustConnector(Connector & con);
 
-	/*! Searches block and socket data structure by flat variable name. */
+	/*! Replaces flat names in connector by socket handles and clears the flat names.
+		Throws an exception if either source or target socket cannot be found. Does nothing
+		if the connector is already resolved.
+	*/
+	void resolveConnector(Connector & con) const;
+
+	/*! Resolves all connectors that still reference sockets via flat names.
+		Connectors with invalid flat names are kept unchanged (checkNames() reports these).
+		Only connectors appended to m_connectors since the last call and connectors that could not be
+		resolved before are processed, so calling this function repeatedly is cheap. If you set flat names
+		of connectors already in the network directly, call unresolveConnectors() before.
+	*/
+	void resolveConnectors();
+
+	/*! Converts socket handles of all connectors back into flat names.
+		Socket handles store the index of the socket in the block's socket list. If you modify
+		the socket lists of blocks in the network directly (e.g. via Block::autoUpdateSockets()), call this function
+		before and resolveConnectors() afterwards.
+	*/
+	void unresolveConnectors();
+
+	/*! Returns the flat name <block-name>.<socket-name> of the socket referenced by the socket handle.
+		Throws an exception if handle is invalid.
+	*/
+	QString socketFlatName(const SocketHandle & socketHandle) const;
+
+	/*! Returns flat name of source socket of connector (connector may be resolved or not). */
+	QString sourceSocketName(const Connector & con) const;
+	/*! Returns flat name of target socket of connector (connector may be resolved or not). */
+	QString targetSocketName(const Connector & con) const;
+
+	/*! Searches block and socket data structure by flat variable name.
+		Uses a hash index on flat names, so that the lookup is O(1) and does not allocate memory
+		when the flat name is given without extra white spaces.
+		Throws an exception if block or socket cannot be found.
+	*/
 	void lookupBlockAndSocket(const QString & flatName, const Block * &block, const Socket * &socket) const;
 
+	/*! Searches block and socket data structure by socket handle (O(1)).
+		Stale handles (referencing removed blocks) are detected.
+		Throws an exception if block or socket cannot be found.
+	*/
+	void lookupBlockAndSocket(const SocketHandle & socketHandle, const Block * &block, const Socket * &socket) const;
+
+	/*! Looks up block and socket of the connector's source socket.
+		Uses the flat name, if the connector is not yet resolved, otherwise the socket handle.
+	*/
+	void lookupSourceSocket(const Connector & con, const Block * &block, const Socket * &socket) const;
+
+	/*! Looks up block and socket of the connector's target socket. */
+	void lookupTargetSocket(const Connector & con, const Block * &block, const Socket * &socket) const;
+
+	/*! Searches block by name (uses the lookup index), returns nullptr if no such block exists. */
+	const Block * blockByName(const QString & blockName) const;
+
+	/*! Returns the handle of a block in the network, or an invalid handle if block is not in the network. */
+	BlockHandle blockHandle(const Block * block) const;
+
+	/*! Returns the handle of a connector in the network, or an invalid handle if connector is not in the network. */
+	ConnectorHandle connectorHandle(const Connector * con) const;
+
+	/*! Returns the handle of a socket of a block in the network, or an invalid handle if block is not
+		in the network or socket is not one of the block's sockets.
+	*/
+	SocketHandle socketHandle(const Block * block, const Socket * socket) const;
+
+	/*! Returns the handle of the connector that ends in the given inlet socket, or an invalid handle
+		if the socket is not connected (O(1)).
+		\note This and the following query functions use an adjacency index that is updated automatically when
+			connectors are added/removed via addConnector(), removeConnector() and removeBlock(). Connectors
+			appended to m_connectors directly are indexed on the next query. When connectors are erased
+			from m_connectors directly, the index is rebuilt.
+	*/
+	ConnectorHandle incomingConnector(const SocketHandle & inletSocket) const;
+
+	/*! Returns the handles of all connectors that originate from the given outlet socket. */
+	QList<ConnectorHandle> outgoingConnectors(const SocketHandle & outletSocket) const;
+
+	/*! Returns the handles of all connectors that start or end in a socket of the given block (O(degree)). */
+	QList<ConnectorHandle> blockConnectors(const BlockHandle & block) const;
+
+	/*! Returns true, if the socket is connected by any connector (O(1)). */
+	bool isConnectedSocket(const SocketHandle & socket) const;
+
+	/*! Returns the bounding rect of the connector polyline, from source socket over all segments to target socket.
+		Throws an exception if source or target socket cannot be found.
+	*/
+	QRectF connectorBoundingRect(const Connector & con) const;
+
+	/*! Returns the handles of all blocks whose rectangle intersects the given rect (in no particular order).
+		\note This and the following spatial queries use a uniform grid index with cells of 16 grid spacings,
+			so that their cost depends on the number of blocks and connectors near the rect and not on the size
+			of the network. The index is built on first use and updated automatically when blocks and connectors
+			are appended, removed via removeBlock(), removeBlocks() and removeConnector(), and when connectors are
+			adjusted via adjustConnector(). When blocks are moved or resized directly in the data structure,
+			call blockGeometryChanged() afterwards.
+	*/
+	QList<BlockHandle> blocksInRect(const QRectF & rect) const;
+
+	/*! Returns the handles of all connectors whose polyline crosses or lies inside the given rect (in no particular order).
+		Connectors that cannot be resolved are skipped.
+	*/
+	QList<ConnectorHandle> connectorsInRect(const QRectF & rect) const;
+
+	/*! Returns the handle of the inlet (or outlet) socket that is closest to pos, if its Manhattan distance
+		to pos is less than maxDistance, or an invalid handle otherwise.
+		Sockets of connection helper blocks are ignored.
+	*/
+	SocketHandle nearestSocket(const QPointF & pos, double maxDistance, bool inlet) const;
+
+	/*! Updates the spatial index after position or size of a block have been changed directly.
+		Connectors attached to the block are updated when they are adjusted with adjustConnector().
+	*/
+	void blockGeometryChanged(const BlockHandle & block);
+
+	/*! Updates the spatial index after segments of a connector have been changed directly (e.g. by moving a segment). */
+	void connectorGeometryChanged(const ConnectorHandle & connector);
+
+	/*! Clears the spatial index, so that it is rebuilt on next query.
+		Call this function after moving many blocks directly, instead of calling blockGeometryChanged() for each block.
+	*/
+	void invalidateSpatialIndex();
+
+	/*! Checks that the connector connects an existing outlet socket with an existing inlet socket, and that
+		the inlet socket is not yet connected by another connector.
+		\param con The connector to check.
+		\param handle The handle of the connector, if it is already part of the network (invalid handle otherwise).
+		Throws an exception if the connector is invalid.
+	*/
+	void checkConnector(const Connector & con, const ConnectorHandle & handle = ConnectorHandle()) const;
+
+	/*! Appends a copy of the connector to the network, resolves its flat names (if possible) and
+		adds it to the adjacency index. Returns handle of the new connector.
+	*/
+	ConnectorHandle addConnector(const Connector & con);
+
+	/*! Removes connector referenced by handle.
+		Throws an exception if the handle is stale.
+	*/
+	void removeConnector(const ConnectorHandle & handle);
+
+	/*! Clears the name lookup index, so that it is rebuilt on next lookup.
+		The index is updated automatically when blocks are appended to m_blocks, or modified via
+		removeBlock() and renameBlock(). Call this function when you erase blocks directly from m_blocks
+		and add others, or when you rename blocks or sockets directly, before calling any lookup function.
+		Outdated index entries are detected during lookup, but names that are not in the index are
+		reported as unknown without rebuilding the index.
+	*/
+	void invalidateLookupIndex();
+
 	/*! Removes block at given index and all associated connectors.
-		\warning Invalidates all block and connector pointers!
+		\warning Invalidates pointers to the removed block and connectors!
 	*/
 	void removeBlock(unsigned int blockIdx);
 
-	/*! Renames a single block. */
+	/*! Removes block referenced by handle and all associated connectors.
+		Throws an exception if the handle is stale.
+	*/
+	void removeBlock(const BlockHandle & handle);
+
+	/*! Removes all blocks referenced by the handles and all associated connectors.
+		Attached connectors are found via the adjacency index and erased by handle, so that no predicate is evaluated
+		for unaffected blocks and connectors. Each erase still shifts the position list of the slot map
+		(see SlotMap::erase()), so the cost is linear in the network size with a small constant. When removing
+		many blocks or connectors (see Globals::SmallRemovalCount), block and connector lists are compacted in a
+		single pass instead.
+		Throws an exception if any of the handles is stale (nothing is removed in this case).
+	*/
+	void removeBlocks(const QList<BlockHandle> & handles);
+
+	/*! Renames a single block.
+		Connectors reference blocks by handle and need not be updated.
+	*/
 	void renameBlock(unsigned int blockIdx, const QString & newName);
 
+	/*! Renames the block referenced by handle.
+		Throws an exception if the handle is stale.
+	*/
+	void renameBlock(const BlockHandle & handle, const QString & newName);
+
 
 	// *** member variables ***
 
 	/*! List of all blocks in the network.
 		\note Cannot use a QList here, because we maintain persistent pointers to block objects
 			and QList's copy-on-write functionality breaks these persistent pointers.
-			We must use a list here, so that when we add a block during the socket-connect operation
-			(the invisible block) the existing nodes are not invalidated.
+			The slot map keeps element addresses stable, so that when we add a block during the
+			socket-connect operation (the invisible block) the existing blocks are not invalidated.
+			Copies of the network keep the block handles, so that socket handles in connectors remain valid.
 	*/
-	std::list<Block>		m_blocks;
+	SlotMap<Block>			m_blocks;
 
 	/*! List of all connectors in the network.
 		Connectors are always associated with sockets (referenced via
-		block-id and socket-id).
+		block handle and socket index).
 	*/
-	std::list<Connector>	m_connectors;
+	SlotMap<Connector>		m_connectors;
 
 
 	// *** static functions ***
@@ -117,8 +334,114 @@ public:
 	static void splitFlatName(const QString & flatVariableName, QString & blockName, QString & socketName);
 
 private:
+	/*! Reads network content from the XML stream (without resolving connectors). */
+	void readXML(QXmlStreamReader & reader);
+
 
 	void readBlocks(QXmlStreamReader & reader);
+
+	/*! Brings the lookup index in sync with m_blocks.
+		Blocks that have been appended to m_blocks since the last update are added to the index.
+		If blocks have been removed from m_blocks directly, the index is rebuilt.
+	*/
+	void updateLookupIndex() const;
+
+	/*! Clears the lookup index. */
+	void resetLookupIndex() const;
+
+	/*! Adds block and all of its sockets to the lookup index. */
+	void addToLookupIndex(const Block & b, const BlockHandle & handle) const;
+
+	/*! Removes block and all of its sockets from the lookup index. */
+	void removeFromLookupIndex(const Block & b) const;
+
+	/*! Looks up the flat name in the socket index and checks, that the block/socket names still
+		match the key (block or socket may have been renamed directly in the data structure).
+		Returns true if a valid socket was found. If the index holds an entry for the flat name that does not
+		match the data structure anymore, outdated is set to true (otherwise it is not modified).
+	*/
+	bool findInLookupIndex(const QString & flatName, BlockHandle & block, int & socketIdx, bool & outdated) const;
+
+	/*! Searches block and index of socket by flat variable name, used by both lookupBlockAndSocket()
+		and resolveConnector(). Throws an exception if block or socket cannot be found.
+	*/
+	void lookupSocketIndex(const QString & flatName, BlockHandle & block, int & socketIdx) const;
+
+	/*! Brings the adjacency index in sync with m_connectors. */
+	void updateAdjacencyIndex() const;
+
+	/*! Clears the adjacency index, so that it is rebuilt on next query. */
+	void resetAdjacencyIndex() const;
+
+	/*! Determines source and target socket handles of a connector (resolved or not).
+		Returns false if connector references sockets that do not exist.
+	*/
+	bool connectorSockets(const Connector & con, SocketHandle & source, SocketHandle & target) const;
+
+	/*! Adds connector to adjacency index. */
+	void addToAdjacencyIndex(const Connector & con, const ConnectorHandle & handle) const;
+
+	/*! Removes connector from adjacency index. */
+	void removeFromAdjacencyIndex(const Connector & con, const ConnectorHandle & handle) const;
+
+	/*! Computes the points of the connector's polyline, from the source socket center to the target socket center.
+		Throws an exception if source or target socket cannot be found.
+	*/
+	void connectorPolyline(const Connector & con, QVector<QPointF> & points) const;
+
+	/*! Brings the spatial index in sync with m_blocks and m_connectors.
+		Appended blocks and connectors are added, if blocks or connectors were erased directly, the index is rebuilt.
+	*/
+	void updateSpatialIndex() const;
+
+	/*! Clears the block part of the spatial index. */
+	void resetBlockGrid() const;
+
+	/*! Clears the connector part of the spatial index. */
+	void resetConnectorGrid() const;
+
+	/*! Adds connector to spatial index (unresolvable connectors are not indexed). */
+	void addToConnectorGrid(const Connector & con, const ConnectorHandle & handle) const;
+
+	/*! Maps block name to block handle.
+		Handles remain valid in copies of the network, hence the index can be copied along.
+	*/
+	mutable QHash<QString, BlockHandle>						m_blockIndex;
+	/*! Maps flat socket name <block-name>.<socket-name> to block handle and index of socket in the block's socket list. */
+	mutable QHash<QString, QPair<BlockHandle, int> >		m_socketIndex;
+	/*! Number of blocks in m_blocks that are included in the lookup index. */
+	mutable size_t											m_indexedBlockCount;
+
+	/*! Maps inlet socket to the connector ending in it. */
+	mutable QHash<SocketHandle, ConnectorHandle>			m_incomingConnectors;
+	/*! Maps outlet socket to all connectors originating from it. */
+	mutable QHash<SocketHandle, QList<ConnectorHandle> >	m_outgoingConnectors;
+	/*! Maps block to all connectors that start or end at one of its sockets. */
+	mutable QHash<BlockHandle, QList<ConnectorHandle> >		m_blockConnectors;
+	/*! Number of connectors in m_connectors that are included in the adjacency index. */
+	mutable size_t											m_adjacencyConnectorCount;
+	/*! Value of m_connectors.eraseCount() when adjacency index was last in sync. */
+	mutable size_t											m_adjacencyEraseCount;
+
+	/*! Number of connectors in m_connectors that have been processed by resolveConnectors(). */
+	size_t													m_resolvedConnectorCount;
+	/*! Value of m_connectors.eraseCount() when resolveConnectors() was last called. */
+	size_t													m_resolveEraseCount;
+	/*! Connectors that could not be resolved by resolveConnectors(), retried on the next call. */
+	QSet<ConnectorHandle>									m_unresolvedConnectors;
+
+	/*! Spatial index of block rectangles. */
+	mutable SpatialGrid<BlockHandle>						m_blockGrid;
+	/*! Number of blocks in m_blocks that are included in the block grid. */
+	mutable size_t											m_gridBlockCount;
+	/*! Value of m_blocks.eraseCount() when the block grid was last in sync. */
+	mutable size_t											m_gridBlockEraseCount;
+	/*! Spatial index of connector bounding rects. */
+	mutable SpatialGrid<ConnectorHandle>					m_connectorGrid;
+	/*! Number of connectors in m_connectors that are included in the connector grid. */
+	mutable size_t											m_gridConnectorCount;
+	/*! Value of m_connectors.eraseCount() when the connector grid was last in sync. */
+	mutable size_t											m_gridConnectorEraseCount;
 };
 
 } // namespace BLOCKMOD
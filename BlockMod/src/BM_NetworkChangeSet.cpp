@@ -0,0 +1,84 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BM_NetworkChangeSet.h"
+
+namespace BLOCKMOD {
+
+void NetworkChangeSet::clear() {
+	m_reset = false;
+	m_blockChanges.clear();
+	m_connectorChanges.clear();
+	m_blockRecords.clear();
+	m_connectorRecords.clear();
+}
+
+
+void NetworkChangeSet::addBlockChange(ChangeType type, const BlockHandle & block, const QString & name,
+									  const QPointF & oldPos, const QString & oldName)
+{
+	if (type == Moved && m_blockRecords.contains(block))
+		return; // already added or moved, first record holds the original position
+	if (type == Removed)
+		m_blockRecords.remove(block);
+	BlockChange c;
+	c.m_type = type;
+	c.m_block = block;
+	c.m_name = name;
+	c.m_oldName = oldName;
+	c.m_oldPos = oldPos;
+	if (type == Added || type == Moved)
+		m_blockRecords.insert(block);
+	m_blockChanges.append(c);
+}
+
+
+void NetworkChangeSet::addConnectorChange(ChangeType type, const ConnectorHandle & connector, const QString & name,
+										  const QString & sourceSocket, const QString & targetSocket)
+{
+	if (type == Moved && m_connectorRecords.contains(connector))
+		return;
+	if (type == Removed)
+		m_connectorRecords.remove(connector);
+	ConnectorChange c;
+	c.m_type = type;
+	c.m_connector = connector;
+	c.m_name = name;
+	c.m_sourceSocket = sourceSocket;
+	c.m_targetSocket = targetSocket;
+	if (type == Added || type == Moved)
+		m_connectorRecords.insert(connector);
+	m_connectorChanges.append(c);
+}
+
+} // namespace BLOCKMOD
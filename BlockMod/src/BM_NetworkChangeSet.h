@@ -0,0 +1,135 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_NetworkChangeSetH
+#define BM_NetworkChangeSetH
+
+#include <QList>
+#include <QMetaType>
+#include <QPointF>
+#include <QSet>
+#include <QString>
+
+#include "BM_Connector.h"
+
+namespace BLOCKMOD {
+
+/*! Describes all changes made to a network by a single operation of the SceneManager (or by a batch edit,
+	or a frame of a coalesced drag session).
+	Records are stored in the order the changes were made, so that consumers can apply them one after another
+	to update their own model in O(change).
+*/
+class NetworkChangeSet {
+public:
+	/*! Type of change. */
+	enum ChangeType {
+		/*! Block or connector was added to the network. */
+		Added,
+		/*! Block or connector was removed from the network, handle is stale. */
+		Removed,
+		/*! Block was moved, or segments of a connector were changed. */
+		Moved,
+		/*! Block was renamed. */
+		Renamed
+	};
+
+	/*! Change record of a single block. */
+	struct BlockChange {
+		ChangeType		m_type;
+		/*! Handle of the block (stale for Removed). */
+		BlockHandle		m_block;
+		/*! Name of the block (new name for Renamed, last name for Removed). */
+		QString			m_name;
+		/*! Name before renaming (Renamed only). */
+		QString			m_oldName;
+		/*! Position before the first move of this change set (Moved only). */
+		QPointF			m_oldPos;
+	};
+
+	/*! Change record of a single connector. */
+	struct ConnectorChange {
+		ChangeType		m_type;
+		/*! Handle of the connector (stale for Removed). */
+		ConnectorHandle	m_connector;
+		/*! Name of the connector. */
+		QString			m_name;
+		/*! Flat name of source socket, e.g. "Block.Socket". */
+		QString			m_sourceSocket;
+		/*! Flat name of target socket. */
+		QString			m_targetSocket;
+	};
+
+	NetworkChangeSet() : m_reset(false) {}
+
+	/*! Returns true if the change set holds neither records nor the reset flag. */
+	bool isEmpty() const { return !m_reset && m_blockChanges.isEmpty() && m_connectorChanges.isEmpty(); }
+
+	/*! Removes all records and the reset flag. */
+	void clear();
+
+	/*! Appends a block record. Moves of the same block are merged into the first Moved record, so that
+		m_oldPos holds the position before the operation. Moves of blocks added in this change set are not recorded.
+	*/
+	void addBlockChange(ChangeType type, const BlockHandle & block, const QString & name,
+						const QPointF & oldPos = QPointF(), const QString & oldName = QString());
+
+	/*! Appends a connector record. Multiple Moved records of the same connector are merged, moves of connectors
+		added in this change set are not recorded.
+	*/
+	void addConnectorChange(ChangeType type, const ConnectorHandle & connector, const QString & name,
+							const QString & sourceSocket, const QString & targetSocket);
+
+	/*! If true, the entire network was replaced (e.g. by SceneManager::setNetwork()) and consumers must
+		re-read it. Records appended afterwards describe changes to the new network.
+	*/
+	bool					m_reset;
+
+	/*! Block records, in the order of the changes. */
+	QList<BlockChange>		m_blockChanges;
+
+	/*! Connector records, in the order of the changes. */
+	QList<ConnectorChange>	m_connectorChanges;
+
+private:
+	/*! Blocks with Added or Moved records (further moves are not recorded). */
+	QSet<BlockHandle>		m_blockRecords;
+	/*! Connectors with Added or Moved records. */
+	QSet<ConnectorHandle>	m_connectorRecords;
+};
+
+} // namespace BLOCKMOD
+
+// needed for queued connections to SceneManager::networkChanged() (registered in the SceneManager constructor)
+Q_DECLARE_METATYPE(BLOCKMOD::NetworkChangeSet)
+
+#endif // BM_NetworkChangeSetH
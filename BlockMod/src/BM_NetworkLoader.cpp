@@ -0,0 +1,188 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BM_NetworkLoader.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrentRun>
+
+#include <stdexcept>
+
+namespace BLOCKMOD {
+
+/*! Read-only device that forwards to a file, reports the reading progress to the loader and
+	stops delivering data once cancellation was requested. The XML reader then fails with a
+	premature end of document error, which is ignored by the loader.
+*/
+class ProgressDevice : public QIODevice {
+public:
+	ProgressDevice(QFile & file, NetworkLoader * loader) :
+		m_file(file),
+		m_loader(loader)
+	{
+	}
+
+	qint64 size() const override { return m_file.size(); }
+
+protected:
+	qint64 readData(char * data, qint64 maxlen) override {
+		if (m_loader->m_cancelRequested.load())
+			return -1;
+		qint64 n = m_file.read(data, maxlen);
+		m_loader->reportProgress(NetworkLoader::ReadingFile, m_file.pos(), m_file.size());
+		return n;
+	}
+
+	qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+	QFile			&m_file;
+	NetworkLoader	*m_loader;
+};
+
+
+NetworkLoader::NetworkLoader(QObject * parent) :
+	QObject(parent),
+	m_cancelRequested(0),
+	m_lastProgress(-1)
+{
+	connect(&m_watcher, &QFutureWatcher<void>::finished, this, &NetworkLoader::onWorkerFinished);
+}
+
+
+NetworkLoader::~NetworkLoader() {
+	cancel();
+	m_watcher.waitForFinished();
+}
+
+
+void NetworkLoader::load(const QString & fname) {
+	if (m_watcher.isRunning()) {
+		cancel();
+		m_watcher.waitForFinished();
+		emit cancelled();
+	}
+	m_cancelRequested.store(0);
+	m_lastProgress.store(-1);
+	m_errorMessage.clear();
+	m_network = Network();
+	// setting a new future also discards pending notifications of the previous one
+	m_watcher.setFuture(QtConcurrent::run(this, &NetworkLoader::run, fname));
+}
+
+
+Network NetworkLoader::takeNetwork() {
+	Network n;
+	n.swap(m_network);
+	return n;
+}
+
+
+void NetworkLoader::cancel() {
+	m_cancelRequested.store(1);
+}
+
+
+void NetworkLoader::onWorkerFinished() {
+	if (m_cancelRequested.load()) {
+		m_network = Network();
+		emit cancelled();
+	}
+	else if (!m_errorMessage.isEmpty())
+		emit failed(m_errorMessage);
+	else
+		emit finished();
+}
+
+
+void NetworkLoader::run(const QString & fname) {
+	try {
+		Network n;
+		if (QFileInfo(fname).suffix() == "bmb") {
+			// binary files are read in one go
+			reportProgress(ReadingFile, 0, 1);
+			n.readBinary(fname);
+			reportProgress(ReadingFile, 1, 1);
+		}
+		else {
+			QFile xmlFile(fname);
+			if (!xmlFile.open(QIODevice::ReadOnly))
+				throw std::runtime_error("Cannot read file.");
+			// text mode translation is done by the progress device, so that progress is reported in file bytes
+			ProgressDevice device(xmlFile, this);
+			device.open(QIODevice::ReadOnly | QIODevice::Text);
+			n.readXML(device);
+		}
+		if (m_cancelRequested.load())
+			return;
+
+		n.checkNames();
+
+		// remove invalid connections and fix any connectors that might miss a bit
+		qint64 count = (qint64)n.m_connectors.size();
+		qint64 processed = 0;
+		n.m_connectors.removeIf([&](Connector & con) {
+			// once cancelled, skip remaining connectors, the network is discarded anyway
+			if (m_cancelRequested.load())
+				return false;
+			reportProgress(AdjustingConnectors, ++processed, count);
+			try {
+				n.adjustConnector(con);
+				return false;
+			}
+			catch (...) {
+				return true;
+			}
+		});
+		if (m_cancelRequested.load())
+			return;
+
+		m_network.swap(n);
+	}
+	catch (std::exception & ex) {
+		// errors caused by cancellation are not reported
+		if (!m_cancelRequested.load())
+			m_errorMessage = QString::fromStdString(ex.what());
+	}
+}
+
+
+void NetworkLoader::reportProgress(int stage, qint64 processed, qint64 total) {
+	int percent = total > 0 ? (int)(processed*100/total) : 100;
+	int value = stage*1000 + percent;
+	if (m_lastProgress.fetchAndStoreRelaxed(value) != value)
+		emit progress(stage, processed, total);
+}
+
+} // namespace BLOCKMOD
@@ -0,0 +1,141 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_NetworkLoaderH
+#define BM_NetworkLoaderH
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+
+#include "BM_Network.h"
+
+namespace BLOCKMOD {
+
+/*! Loads a network on a worker thread.
+	The file is parsed, names are checked and all connectors are adjusted in a thread of the global thread pool,
+	so that the GUI stays responsive while large networks are loaded. Connectors that cannot be adjusted are removed,
+	just as when loading the network interactively.
+
+	Usage:
+	\code
+	NetworkLoader * loader = new NetworkLoader(this);
+	connect(loader, &NetworkLoader::finished, [=]() {
+		sceneManager->setNetwork(loader->takeNetwork());
+	});
+	loader->load("large_network.bm");
+	\endcode
+
+	All signals are emitted in the thread the loader lives in (usually the GUI thread).
+*/
+class NetworkLoader : public QObject {
+	Q_OBJECT
+public:
+	/*! The stages of the loading process, reported in progress(). */
+	enum Stage {
+		/*! Reading the file, progress is given in bytes. */
+		ReadingFile,
+		/*! Checking names and adjusting connectors, progress is given in number of connectors. */
+		AdjustingConnectors
+	};
+
+	/*! C'tor. */
+	explicit NetworkLoader(QObject * parent = nullptr);
+	/*! D'tor, cancels a running load and waits for the worker to finish. */
+	~NetworkLoader() override;
+
+	/*! Starts loading the network from file fname, either in XML or binary format (selected by suffix '.bmb').
+		A load that is still running is cancelled first, in this case cancelled() is emitted before this function
+		returns (and before the new load is started).
+	*/
+	void load(const QString & fname);
+
+	/*! Returns true while a network is being loaded. */
+	bool isRunning() const { return m_watcher.isRunning(); }
+
+	/*! The future of the running (or last) load, can be used to wait for the result. */
+	QFuture<void> future() const { return m_watcher.future(); }
+
+	/*! Returns the loaded network and leaves an empty network in the loader.
+		Call this function after finished() was emitted.
+	*/
+	Network takeNetwork();
+
+public slots:
+	/*! Requests cancellation of the running load. The worker stops at the next check and cancelled() is emitted. */
+	void cancel();
+
+signals:
+	/*! Emitted during loading, at most once per percent of each stage.
+		Stage is one of Stage, processed and total are given in bytes or connectors, depending on stage.
+	*/
+	void progress(int stage, qint64 processed, qint64 total);
+
+	/*! Emitted when the network was loaded successfully, retrieve it with takeNetwork(). */
+	void finished();
+
+	/*! Emitted when loading failed. */
+	void failed(const QString & errorMessage);
+
+	/*! Emitted when loading was cancelled. */
+	void cancelled();
+
+private slots:
+	/*! Connected to the future watcher, emits finished(), failed() or cancelled(). */
+	void onWorkerFinished();
+
+private:
+	/*! Runs in the worker thread, loads the network into m_network. */
+	void run(const QString & fname);
+
+	/*! Emits progress() if stage or percentage changed since the last call (thread-safe). */
+	void reportProgress(int stage, qint64 processed, qint64 total);
+
+	friend class ProgressDevice;
+
+	/*! Watches the worker. */
+	QFutureWatcher<void>	m_watcher;
+	/*! Set to 1 when cancellation was requested. */
+	QAtomicInt				m_cancelRequested;
+	/*! Last reported progress, encoded as stage*1000 + percent, -1 before first report. */
+	QAtomicInt				m_lastProgress;
+
+	/*! The loaded network, only accessed by the worker until it has finished. */
+	Network					m_network;
+	/*! Error message in case loading failed. */
+	QString					m_errorMessage;
+};
+
+} // namespace BLOCKMOD
+
+#endif // BM_NetworkLoaderH
@@ -0,0 +1,79 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BM_NetworkSnapshot.h"
+
+#include "BM_Network.h"
+
+namespace BLOCKMOD {
+
+QString NetworkSnapshot::sourceSocketName(const Connector & con) const {
+	if (!con.m_sourceSocket.isEmpty() || !con.m_source.isValid())
+		return con.m_sourceSocket;
+	return socketFlatName(con.m_source);
+}
+
+
+QString NetworkSnapshot::targetSocketName(const Connector & con) const {
+	if (!con.m_targetSocket.isEmpty() || !con.m_target.isValid())
+		return con.m_targetSocket;
+	return socketFlatName(con.m_target);
+}
+
+
+void NetworkSnapshot::toNetwork(Network & network) const {
+	Network n;
+	for (const BlockHandle & h : m_blockOrder)
+		n.m_blocks.push_back(*m_blocks.get(h));
+	for (const ConnectorHandle & h : m_connectorOrder) {
+		const Connector & con = *m_connectors.get(h);
+		// block handles differ in the new network, so connectors reference the sockets by name
+		Connector c(con);
+		c.m_sourceSocket = sourceSocketName(con);
+		c.m_targetSocket = targetSocketName(con);
+		c.m_source = SocketHandle();
+		c.m_target = SocketHandle();
+		n.m_connectors.push_back(c);
+	}
+	network.swap(n);
+}
+
+
+QString NetworkSnapshot::socketFlatName(const SocketHandle & socket) const {
+	const Block * b = block(socket.m_block);
+	if (b == nullptr || socket.m_socketIdx < 0 || socket.m_socketIdx >= b->m_sockets.count())
+		return QString();
+	return b->m_name + "." + b->m_sockets[socket.m_socketIdx].m_name;
+}
+
+} // namespace BLOCKMOD
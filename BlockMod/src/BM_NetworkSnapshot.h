@@ -0,0 +1,170 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_NetworkSnapshotH
+#define BM_NetworkSnapshotH
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include "BM_Block.h"
+#include "BM_Connector.h"
+
+namespace BLOCKMOD {
+
+class Network;
+
+/*! Shared elements of a snapshot, indexed by the slot index of their handles.
+	Elements are stored in pages of fixed size. Pages and the page table are implicitly shared, so that copying
+	is O(1), and modifying an element of a copy only copies the page table (O(n/PageSize)) and the affected page
+	(O(PageSize)), all other pages remain shared with the original.
+*/
+template <typename T>
+class SnapshotPages {
+public:
+	/*! Returns the element referenced by handle, or nullptr if the element is not stored (or handle is stale). */
+	const T * get(const SlotHandle<T> & handle) const {
+		unsigned int p = handle.m_index / PageSize;
+		if (!handle.isValid() || p >= static_cast<unsigned int>(m_pages.size()))
+			return nullptr;
+		const QVector<Entry> & page = m_pages.at(static_cast<int>(p));
+		if (page.isEmpty())
+			return nullptr;
+		const Entry & e = page.at(static_cast<int>(handle.m_index % PageSize));
+		if (e.m_generation != handle.m_generation)
+			return nullptr;
+		return e.m_value.data();
+	}
+
+	/*! Stores the element for the handle, replaces an element stored for the same slot. */
+	void insert(const SlotHandle<T> & handle, const QSharedPointer<const T> & value) {
+		int p = static_cast<int>(handle.m_index / PageSize);
+		if (p >= m_pages.size())
+			m_pages.resize(p+1);
+		QVector<Entry> & page = m_pages[p];
+		if (page.isEmpty())
+			page.resize(PageSize);
+		Entry & e = page[static_cast<int>(handle.m_index % PageSize)];
+		e.m_generation = handle.m_generation;
+		e.m_value = value;
+	}
+
+	/*! Removes the element referenced by handle. Does nothing (and does not copy any page), if the element
+		is not stored, e.g. because the slot holds a newer element already.
+	*/
+	void remove(const SlotHandle<T> & handle) {
+		if (get(handle) == nullptr)
+			return;
+		int p = static_cast<int>(handle.m_index / PageSize);
+		m_pages[p][static_cast<int>(handle.m_index % PageSize)].m_value.clear();
+	}
+
+private:
+	/*! Number of elements per page. */
+	static const unsigned int PageSize = 256;
+
+	/*! An element, together with the generation of the handle it was stored for. */
+	struct Entry {
+		Entry() : m_generation(0) {}
+		unsigned int			m_generation;
+		QSharedPointer<const T>	m_value;
+	};
+
+	/*! Page table, pages are allocated when the first element is stored in them. */
+	QVector< QVector<Entry> >	m_pages;
+};
+
+
+/*! An immutable, read-only view of a network at the time the snapshot was taken (see Network::snapshot() and
+	SceneManager::snapshot()).
+
+	Blocks and connectors are held by shared pointers in implicitly shared pages (see SnapshotPages). Copying a
+	snapshot is O(1), and consecutive snapshots share all blocks and connectors that have not been changed in between.
+	Snapshots can be passed to and read from other threads while the network is edited.
+
+	Blocks and connectors keep the handles of the network they were taken from. Connectors reference their
+	sockets by handle, use sourceSocketName() and targetSocketName() to get the flat socket names.
+*/
+class NetworkSnapshot {
+public:
+	/*! Returns true if the snapshot does not contain any blocks or connectors. */
+	bool isEmpty() const { return m_blockOrder.isEmpty() && m_connectorOrder.isEmpty(); }
+
+	/*! Returns the number of blocks. */
+	int blockCount() const { return m_blockOrder.count(); }
+	/*! Returns the handle of the block at position idx (order of the network's block list). */
+	BlockHandle blockHandle(int idx) const { return m_blockOrder[idx]; }
+	/*! Returns the block at position idx. */
+	const Block & block(int idx) const { return *m_blocks.get(m_blockOrder[idx]); }
+	/*! Returns the block with the given handle, or nullptr if the handle is not part of the snapshot. */
+	const Block * block(const BlockHandle & handle) const { return m_blocks.get(handle); }
+
+	/*! Returns the number of connectors. */
+	int connectorCount() const { return m_connectorOrder.count(); }
+	/*! Returns the handle of the connector at position idx. */
+	ConnectorHandle connectorHandle(int idx) const { return m_connectorOrder[idx]; }
+	/*! Returns the connector at position idx. */
+	const Connector & connector(int idx) const { return *m_connectors.get(m_connectorOrder[idx]); }
+	/*! Returns the connector with the given handle, or nullptr if the handle is not part of the snapshot. */
+	const Connector * connector(const ConnectorHandle & handle) const { return m_connectors.get(handle); }
+
+	/*! Returns the flat name (<block-name>.<socket-name>) of the connector's source socket. */
+	QString sourceSocketName(const Connector & con) const;
+	/*! Returns the flat name of the connector's target socket. */
+	QString targetSocketName(const Connector & con) const;
+
+	/*! Copies the snapshot into a new network (e.g. to write it to file or to run network algorithms).
+		Connectors are stored with flat socket names and are resolved by the network when needed.
+	*/
+	void toNetwork(Network & network) const;
+
+private:
+	/*! Returns the flat name of the given socket, or an empty string if the socket is unknown. */
+	QString socketFlatName(const SocketHandle & socket) const;
+
+	/*! Blocks in the order of the network's block list. */
+	QVector<BlockHandle>			m_blockOrder;
+	/*! Blocks by handle. */
+	SnapshotPages<Block>			m_blocks;
+	/*! Connectors in the order of the network's connector list. */
+	QVector<ConnectorHandle>		m_connectorOrder;
+	/*! Connectors by handle. */
+	SnapshotPages<Connector>		m_connectors;
+
+	// Network creates the snapshot data
+	friend class Network;
+};
+
+} // namespace BLOCKMOD
+
+#endif // BM_NetworkSnapshotH
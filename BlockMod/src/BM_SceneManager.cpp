@@ -39,62 +39,336 @@
 #include <QDebug>
 #include <QApplication>
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
 #include <QTimer>
+#include <QStringList>
+#include <QElapsedTimer>
 
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 #include "BM_Network.h"
 #include "BM_Socket.h"
 #include "BM_BlockItem.h"
 #include "BM_ConnectorSegmentItem.h"
+#include "BM_ConnectorPathItem.h"
 #include "BM_Globals.h"
 #include "BM_SocketItem.h"
+#include "BM_ZoomMeshGraphicsView.h"
 
 namespace BLOCKMOD {
 
 SceneManager::SceneManager(QObject *parent) :
 	QGraphicsScene(parent),
-	m_network(new Network)
+	m_network(new Network),
+	m_connectorItemMode(SegmentItems),
+	m_currentlyConnecting(false),
+	m_batchDepth(0),
+	m_batchGeometryChanged(false),
+	m_batchBlocksRemoved(false),
+	m_pendingItemPos(0),
+	m_populationTimer(new QTimer(this)),
+	m_populationTimeBudget(8),
+	m_virtualized(false),
+	m_virtualizationTimer(new QTimer(this)),
+	m_layeredInteraction(false),
+	m_layerFilter(AllLayers),
+	m_coalescedDragUpdates(false),
+	m_dragSessionActive(false),
+	m_dragTimer(new QTimer(this)),
+	m_undoEnabled(false),
+	m_applyingUndo(false),
+	m_undoLimit(100),
+	m_snapshotValid(false),
+	m_snapshotOrderChanged(false)
 {
+	// signal arguments must be registered with their typedef names for queued connections
+	qRegisterMetaType<QSet<BLOCKMOD::BlockHandle> >("QSet<BLOCKMOD::BlockHandle>");
+	qRegisterMetaType<QSet<BLOCKMOD::ConnectorHandle> >("QSet<BLOCKMOD::ConnectorHandle>");
+	qRegisterMetaType<BLOCKMOD::NetworkChangeSet>("BLOCKMOD::NetworkChangeSet");
+
 	// listen for selection changes
+
+	// create next chunk of items in each event loop turn while populating
+	m_populationTimer->setInterval(0);
+	connect(m_populationTimer, &QTimer::timeout, this, [this]() {
+		populateItems(m_populationTimeBudget);
+	});
+
+	// update items of virtualized scene once per event loop turn
+	m_virtualizationTimer->setInterval(0);
+	m_virtualizationTimer->setSingleShot(true);
+	connect(m_virtualizationTimer, &QTimer::timeout, this, &SceneManager::updateVirtualizedItems);
+
+	// update connectors of dragged blocks once per frame
+	m_dragTimer->setInterval(Globals::DragUpdateInterval);
+	m_dragTimer->setSingleShot(true);
+	connect(m_dragTimer, &QTimer::timeout, this, &SceneManager::flushDragUpdates);
 }
 
 
 SceneManager::~SceneManager() {
+	// pooled items are not part of the scene
+	qDeleteAll(m_blockItemPool);
 	delete m_network;
 }
 
 
 void SceneManager::setNetwork(const Network & network) {
-	*m_network = network;
+	setNetwork(Network(network));
+}
 
-	qDeleteAll(m_blockItems);
-	m_blockItems.clear();
-	qDeleteAll(m_connectorSegmentItems);
-	m_connectorSegmentItems.clear();
 
-	// clear block connector map
-	m_blockConnectorMap.clear();
+void SceneManager::setNetwork(Network && network) {
+	setNetworkData(std::move(network));
+
+	if (m_virtualized) {
+		updateVirtualizedItems();
+		emitNetworkChanged();
+		return;
+	}
 
 	// create new graphics items
 	for (Block & b : m_network->m_blocks) {
 		BlockItem * item = createBlockItem( b );
 		addItem(item);
 		m_blockItems.append(item);
+		m_blockItemIndex.insert(item->m_block, item);
 	}
 
 	// create new graphics items for connectors
+	for (Connector & c : m_network->m_connectors)
+		addConnectorItems(c);
+	emitNetworkChanged();
+}
+
+
+void SceneManager::setNetworkIncremental(Network && network, const QRectF & priorityRect) {
+	setNetworkData(std::move(network));
+
+	// only few items are needed in virtualized mode
+	if (m_virtualized) {
+		updateVirtualizedItems();
+		emitNetworkChanged();
+		emit populationFinished();
+		return;
+	}
+
+	QRectF rect = priorityRect;
+	if (rect.isEmpty() && !views().isEmpty()) {
+		QGraphicsView * view = views().first();
+		rect = view->mapToScene(view->viewport()->rect()).boundingRect();
+	}
+	// without priority rect, all distances are zero and items are created in network order
+	QPointF center = rect.center();
+	auto blockDistance = [&rect, &center](const Block & b) -> double {
+		if (rect.isEmpty())
+			return 0;
+		return QLineF(center, b.m_pos + QPointF(0.5*b.m_size.width(), 0.5*b.m_size.height())).length();
+	};
+
+	m_pendingItems.reserve((int)(m_network->m_blocks.size() + m_network->m_connectors.size()));
+	for (unsigned int i=0; i<m_network->m_blocks.size(); ++i) {
+		PendingItem p;
+		p.m_distance = blockDistance(m_network->m_blocks[i]);
+		p.m_block = m_network->m_blocks.handle(i);
+		m_pendingItems.append(p);
+	}
+	// connectors are created after the blocks they connect
+	for (unsigned int i=0; i<m_network->m_connectors.size(); ++i) {
+		const Connector & con = m_network->m_connectors[i];
+		const Block * source = m_network->m_blocks.get(con.m_source.m_block);
+		const Block * target = m_network->m_blocks.get(con.m_target.m_block);
+		PendingItem p;
+		if (source != nullptr && target != nullptr)
+			p.m_distance = std::max(blockDistance(*source), blockDistance(*target));
+		else
+			p.m_distance = std::numeric_limits<double>::max(); // unresolved connectors last
+		p.m_connector = m_network->m_connectors.handle(i);
+		m_pendingItems.append(p);
+	}
+	std::stable_sort(m_pendingItems.begin(), m_pendingItems.end(),
+					 [](const PendingItem & a, const PendingItem & b) { return a.m_distance < b.m_distance; });
+
+	// create the first chunk right away, the remaining items in the following event loop turns
+	populateItems(m_populationTimeBudget);
+	if (isPopulating())
+		m_populationTimer->start();
+	emitNetworkChanged();
+}
+
+
+void SceneManager::finishPopulation() {
+	if (isPopulating())
+		populateItems(-1);
+}
+
+
+void SceneManager::setVirtualized(bool virtualized) {
+	if (virtualized == m_virtualized)
+		return;
+	m_virtualized = virtualized;
+	if (m_virtualized) {
+		finishPopulation();
+		updateVirtualSceneRect();
+		updateVirtualizedItems();
+		return;
+	}
+
+	m_virtualizationTimer->stop();
+	qDeleteAll(m_blockItemPool);
+	m_blockItemPool.clear();
+	// create items for all blocks and connectors that are not shown yet
+	QSet<const Block*> shownBlocks;
+	for (const BlockItem * bi : qAsConst(m_blockItems))
+		shownBlocks.insert(bi->m_block);
+	for (Block & b : m_network->m_blocks) {
+		if (shownBlocks.contains(&b))
+			continue;
+		BlockItem * item = createBlockItem(b);
+		addItem(item);
+		m_blockItems.append(item);
+		m_blockItemIndex.insert(item->m_block, item);
+	}
 	for (Connector & c : m_network->m_connectors) {
-		QList<ConnectorSegmentItem *> newConns = createConnectorItems(c);
-		for( BLOCKMOD::ConnectorSegmentItem * item : qAsConst(newConns)) {
-			addItem(item);
-			m_connectorSegmentItems.append(item);
-//			qDebug() << item << " : " << item->m_connector << " : " << item->m_segmentIdx << " : " << item->line();
+		if (!m_connectorItems.contains(&c))
+			addConnectorItems(c);
+	}
+	// scene rect is computed from items again
+	setSceneRect(QRectF());
+}
+
+
+void SceneManager::updateVisibleArea() {
+	if (m_virtualized)
+		m_virtualizationTimer->start();
+}
+
+
+void SceneManager::updateSocketLabels() {
+	// pooled items are updated when they are re-used
+	for (BlockItem * bi : qAsConst(m_blockItems)) {
+		for (SocketItem * si : qAsConst(bi->m_socketItems)) {
+			si->updateSocketItem();
+			si->update();
 		}
 	}
+}
 
-	// initially, we are not in connection mode
-	m_currentlyConnecting = false;
+
+void SceneManager::setLayeredInteraction(bool enabled) {
+	if (!enabled)
+		finishInteraction();
+	m_layeredInteraction = enabled;
+}
+
+
+void SceneManager::setCoalescedDragUpdates(bool enabled) {
+	if (!enabled)
+		finishDragSession();
+	m_coalescedDragUpdates = enabled;
+}
+
+
+NetworkSnapshot SceneManager::snapshot() {
+	if (m_batchDepth > 0)
+		throw std::runtime_error("[SceneManager::snapshot] Cannot take snapshot while in batch mode");
+	// pending moves of a drag session are part of the snapshot
+	if (m_dragSessionActive)
+		flushDragUpdates();
+
+	if (!m_snapshotValid) {
+		m_snapshot = m_network->snapshot();
+		m_snapshotValid = true;
+	}
+	else {
+		// copy only changed blocks and connectors, all others are shared with the previous snapshot
+		m_snapshot = m_network->snapshot(m_snapshot, m_snapshotBlocks, m_snapshotConnectors, m_snapshotOrderChanged);
+	}
+	m_snapshotBlocks.clear();
+	m_snapshotConnectors.clear();
+	m_snapshotOrderChanged = false;
+	return m_snapshot;
+}
+
+
+void SceneManager::setUndoEnabled(bool enabled) {
+	if (!enabled)
+		clearUndoStack();
+	m_undoEnabled = enabled;
+}
+
+
+void SceneManager::setUndoLimit(int limit) {
+	m_undoLimit = std::max(1, limit);
+	while (m_undoStack.count() > m_undoLimit)
+		m_undoStack.removeFirst();
+}
+
+
+void SceneManager::undo() {
+	if (m_batchDepth > 0)
+		throw std::runtime_error("[SceneManager::undo] Cannot undo while in batch mode");
+	// pending moves of a drag session form the last step
+	finishDragSession();
+	if (m_undoStack.isEmpty())
+		return;
+	UndoStep step = m_undoStack.takeLast();
+	try {
+		applyUndoStep(step, true);
+	}
+	catch (...) {
+		// keep the step, so that the undo/redo stacks still match the network
+		m_undoStack.append(step);
+		throw;
+	}
+	m_redoStack.append(step);
+	emit undoStackChanged();
+}
+
+
+void SceneManager::redo() {
+	if (m_batchDepth > 0)
+		throw std::runtime_error("[SceneManager::redo] Cannot redo while in batch mode");
+	if (m_redoStack.isEmpty())
+		return;
+	UndoStep step = m_redoStack.takeLast();
+	try {
+		applyUndoStep(step, false);
+	}
+	catch (...) {
+		m_redoStack.append(step);
+		throw;
+	}
+	m_undoStack.append(step);
+	emit undoStackChanged();
+}
+
+
+void SceneManager::clearUndoStack() {
+	m_undoStep = UndoStep();
+	m_undoStack.clear();
+	m_redoStack.clear();
+	m_undoBlockHandles.clear();
+	m_undoConnectorHandles.clear();
+	emit undoStackChanged();
+}
+
+
+bool SceneManager::isLiveItem(const QGraphicsItem * item) const {
+	if (m_liveBlocks.isEmpty())
+		return false;
+	// socket items are children of block items
+	const QGraphicsItem * topLevel = item->topLevelItem();
+	const BlockItem * bi = dynamic_cast<const BlockItem *>(topLevel);
+	if (bi != nullptr)
+		return m_liveBlocks.contains(bi->block());
+	// also path items
+	const ConnectorSegmentItem * ci = dynamic_cast<const ConnectorSegmentItem *>(topLevel);
+	if (ci != nullptr)
+		return m_liveConnectors.contains(ci->m_connector);
+	return false;
 }
 
 
@@ -153,6 +427,11 @@ QPixmap SceneManager::generatePixmap(QSize targetSize) {
 }
 
 
+BlockItem * SceneManager::blockItem(const Block * block) const {
+	return m_blockItemIndex.value(block, nullptr);
+}
+
+
 const BlockItem * SceneManager::blockItemByName(const QString & blockName) const {
 	for (BlockItem* item : m_blockItems) {
 		if (item->m_block->m_name == blockName)
@@ -162,14 +441,49 @@ const BlockItem * SceneManager::blockItemByName(const QString & blockName) const
 }
 
 
-void SceneManager::blockMoved(const Block * block, const QPointF /*oldPos*/) {
+void SceneManager::blockMoved(const Block * block, const QPointF oldPos) {
+	// keep spatial index of network in sync
+	m_network->blockGeometryChanged(m_network->blockHandle(block));
+	recordBlockChange(NetworkChangeSet::Moved, *block, oldPos);
+	// in two-layer mode, dragging a block starts an interaction
+	if (m_layeredInteraction && m_liveBlocks.isEmpty()) {
+		const BlockItem * grabber = dynamic_cast<const BlockItem *>(mouseGrabberItem());
+		if (grabber != nullptr)
+			startInteraction(grabber);
+	}
+	// in virtualized mode, the scene rect is not computed from the items
+	if (m_virtualized)
+		extendVirtualSceneRect(QRectF(block->m_pos, block->m_size));
+	// in batch mode, connectors are adjusted once in commitBatch()
+	if (m_batchDepth > 0) {
+		m_batchMovedBlocks.insert(m_network->blockHandle(block));
+		m_batchGeometryChanged = true;
+		return;
+	}
+	// in coalesced drag mode, connectors are adjusted once per frame in flushDragUpdates()
+	if (m_coalescedDragUpdates && !m_currentlyConnecting &&
+		(m_dragSessionActive || dynamic_cast<const BlockItem *>(mouseGrabberItem()) != nullptr))
+	{
+		m_dragSessionActive = true;
+		m_dragMovedBlocks.insert(m_network->blockHandle(block));
+		if (!m_dragTimer->isActive())
+			m_dragTimer->start();
+		return;
+	}
 	// lookup connected connectors
-	QSet<Connector *> & cons = m_blockConnectorMap[block];
+	const BlockHandle bh = m_network->blockHandle(block);
+	const QList<ConnectorHandle> cons = m_network->blockConnectors(bh);
 	// adjust connectors to new block positions
-	for (Connector * con : cons) {
+	QSet<ConnectorHandle> conSet;
+	conSet.reserve(cons.count());
+	for (const ConnectorHandle & ch : cons) {
+		conSet.insert(ch);
+		Connector * con = m_network->m_connectors.get(ch);
+		connectorAboutToMove(*con);
 		m_network->adjustConnector(*con);
 		// update corresponding connectorItems (maybe remove/add items)
 		updateConnectorSegmentItems(*con, nullptr);
+		recordConnectorChange(NetworkChangeSet::Moved, *con);
 	}
 
 	// Mind the following problem:
@@ -180,7 +494,8 @@ void SceneManager::blockMoved(const Block * block, const QPointF /*oldPos*/) {
 
 	// Rule: never ever call setNetwork() when processing this signal!
 
-	emit networkGeometryChanged(); /// \todo add old position to signal
+	emit networkGeometryChanged(QSet<BlockHandle>() << bh, conSet);
+	emitNetworkChanged();
 }
 
 
@@ -192,47 +507,58 @@ void SceneManager::blockSelected(const Block * block) {
 void SceneManager::connectorSegmentMoved(ConnectorSegmentItem * currentItem) {
 	// update corresponding connectorItems (maybe remove/add items)
 	updateConnectorSegmentItems(*currentItem->m_connector, currentItem);
-	emit networkGeometryChanged();
+	const ConnectorHandle ch = m_network->connectorHandle(currentItem->m_connector);
+	m_network->connectorGeometryChanged(ch);
+	recordConnectorChange(NetworkChangeSet::Moved, *currentItem->m_connector);
+	if (m_batchDepth > 0)
+		m_batchGeometryChanged = true;
+	else {
+		emit networkGeometryChanged(QSet<BlockHandle>(), QSet<ConnectorHandle>() << ch);
+		emitNetworkChanged();
+	}
+}
+
+
+void SceneManager::connectorAboutToMove(const Connector & con) {
+	if (m_undoEnabled && !m_applyingUndo && con.m_name != Globals::InvisibleLabel)
+		m_undoStep.captureConnector(m_network->connectorHandle(&con), con);
 }
 
 
 void SceneManager::highlightConnectorSegments(const Connector & con, bool highlighted) {
-	for (ConnectorSegmentItem* segmentItem : qAsConst(m_connectorSegmentItems)) {
-		if (segmentItem->m_connector == &con) {
-			segmentItem->m_isHighlighted = highlighted;
-			segmentItem->update();
-		}
+	const QList<ConnectorSegmentItem*> items = m_connectorItems.value(&con).allItems();
+	for (ConnectorSegmentItem* segmentItem : items) {
+		segmentItem->m_isHighlighted = highlighted;
+		segmentItem->update();
 	}
-	this->update();
 }
 
 
 void SceneManager::selectConnectorSegments(const Connector & con) {
 	qDebug() << "SceneManager::selectConnectorSegments";
-	for (ConnectorSegmentItem* segmentItem : qAsConst(m_connectorSegmentItems)) {
-		if (segmentItem->m_connector == &con) {
-			if (!segmentItem->isSelected())
-				segmentItem->setSelected(true);
-			segmentItem->update();
-		}
+	const QList<ConnectorSegmentItem*> items = m_connectorItems.value(&con).allItems();
+	for (ConnectorSegmentItem* segmentItem : items) {
+		if (!segmentItem->isSelected())
+			segmentItem->setSelected(true);
+		segmentItem->update();
 	}
-	this->update();
 }
 
 
 void SceneManager::mergeConnectorSegments(Connector & con) {
-	// collect an ordered list of segment items
-	QList<ConnectorSegmentItem*> segmentItems;
-	for (int i=0; i<con.m_segments.count(); ++i)
-		segmentItems.append(nullptr);
-	for (ConnectorSegmentItem* segmentItem : qAsConst(m_connectorSegmentItems)) {
-		if (segmentItem->m_connector == &con) {
-			if (segmentItem->m_segmentIdx == -1 || segmentItem->m_segmentIdx == -2)
-				continue;
-			Q_ASSERT(segmentItem->m_segmentIdx < segmentItems.count());
-			segmentItems[segmentItem->m_segmentIdx] = segmentItem;
-		}
+	connectorAboutToMove(con);
+	// path items represent all segments, so we only need to merge the connector data
+	ConnectorPathItem * pathItem = m_connectorItems.value(&con).m_pathItem;
+	if (pathItem != nullptr) {
+		con.mergeSegments();
+		updateConnectorSegmentItems(con, nullptr);
+		recordConnectorChange(NetworkChangeSet::Moved, con);
+		emitNetworkChanged();
+		return;
 	}
+	// ordered list of segment items (modified in place when items are removed)
+	QList<ConnectorSegmentItem*> & segmentItems = m_connectorItems[&con].m_segmentItems;
+	Q_ASSERT(segmentItems.count() == con.m_segments.count());
 	// now look for segments with near zero distance
 	int i = 0;
 	bool updateSegments = false;
@@ -265,7 +591,6 @@ void SceneManager::mergeConnectorSegments(Connector & con) {
 			con.m_segments.removeFirst();
 			ConnectorSegmentItem * segItem = segmentItems.front();
 			segmentItems.removeFirst();
-			m_connectorSegmentItems.removeOne(segItem);
 			delete segItem;
 			// update segment indexes of remaining segments
 			for (int j=0; j<segmentItems.count(); ++j)
@@ -275,7 +600,6 @@ void SceneManager::mergeConnectorSegments(Connector & con) {
 			con.m_segments.removeLast();
 			ConnectorSegmentItem * segItem = segmentItems.back();
 			segmentItems.removeLast();
-			m_connectorSegmentItems.removeOne(segItem);
 			delete segItem;
 			i = 0; // signal to try again
 		}
@@ -286,7 +610,6 @@ void SceneManager::mergeConnectorSegments(Connector & con) {
 			con.m_segments.removeAt(i);
 			ConnectorSegmentItem * segItem = segmentItems[i];
 			segmentItems.removeAt(i);
-			m_connectorSegmentItems.removeOne(segItem);
 			delete segItem;
 			// update segment indexes of remaining segments
 			for (int j=i; j<segmentItems.count(); ++j)
@@ -302,7 +625,6 @@ void SceneManager::mergeConnectorSegments(Connector & con) {
 				con.m_segments.removeAt(i);
 				ConnectorSegmentItem * segItem = segmentItems[i];
 				segmentItems.removeAt(i);
-				m_connectorSegmentItems.removeOne(segItem);
 				delete segItem;
 				// update segment indexes of remaining segments
 				for (int j=i; j<segmentItems.count(); ++j)
@@ -317,37 +639,29 @@ void SceneManager::mergeConnectorSegments(Connector & con) {
 	}
 	if (updateSegments)
 		updateConnectorSegmentItems(con, nullptr);
+	recordConnectorChange(NetworkChangeSet::Moved, con);
+	emitNetworkChanged();
 	QApplication::restoreOverrideCursor();
 }
 
 
 bool SceneManager::isConnectedSocket(const Block * b, const Socket * s) const {
-	QMap<const Block*, QSet<Connector*> >::const_iterator it = m_blockConnectorMap.find(b);
-	if (it == m_blockConnectorMap.end())
-		return false;
-	// process all connectors and check, if they connect to the given socket
-	for (const Connector * c : it.value() ) {
-		const Socket * socket;
-		const Block * block;
-		m_network->lookupBlockAndSocket(c->m_sourceSocket, block, socket);
-		if (s == socket)
-			return true;
-		m_network->lookupBlockAndSocket(c->m_targetSocket, block, socket);
-		if (s == socket)
-			return true;
-	}
-	return false;
+	return m_network->isConnectedSocket(m_network->socketHandle(b, s));
 }
 
 
 void SceneManager::startSocketConnection(const SocketItem & outletSocketItem, const QPointF & mousePos) {
 	Q_ASSERT(!outletSocketItem.socket()->m_inlet);
 
+	// the item of the connection helper block must be the last block item
+	finishPopulation();
+
 	// deselect all blocks and connectors
 	for (BLOCKMOD::BlockItem * block : qAsConst(m_blockItems))
 		block->setSelected(false);
-	for (BLOCKMOD::ConnectorSegmentItem * segmentItem : qAsConst(m_connectorSegmentItems))
-		segmentItem->setSelected(false);
+	for (const ConnectorItems & items : qAsConst(m_connectorItems))
+		for (BLOCKMOD::ConnectorSegmentItem * segmentItem : items.allItems())
+			segmentItem->setSelected(false);
 
 	// determine block that this outlet socket item belongs to
 	BlockItem * bitem = dynamic_cast<BlockItem *>(outletSocketItem.parentItem());
@@ -382,23 +696,21 @@ void SceneManager::startSocketConnection(const SocketItem & outletSocketItem, co
 	con.m_sourceSocket = startSocketName;
 	con.m_targetSocket = targetSocketName;
 	m_network->m_connectors.push_back(con);
+	m_network->resolveConnector(m_network->m_connectors.back());
 
 	// now create block item and connector items
 	BlockItem * bi = createBlockItem(m_network->m_blocks.back()); // Mind: always pass the object in the m_block list
 	bi->setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
 	bi->setPos(dummyBlock.m_pos);
 	m_blockItems.append(bi);
+	m_blockItemIndex.insert(bi->m_block, bi);
 
 	bi->setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemSendsGeometryChanges);
 	bi->setPos(dummyBlock.m_pos);
 
 	addItem(bi);
 
-	QList<ConnectorSegmentItem*> newConns = createConnectorItems(m_network->m_connectors.back());  // Mind: always pass the object in the m_connectors list
-	for( BLOCKMOD::ConnectorSegmentItem * item : qAsConst(newConns)) {
-		addItem(item);
-		m_connectorSegmentItems.append(item);
-	}
+	addConnectorItems(m_network->m_connectors.back());  // Mind: always pass the object in the m_connectors list
 
 	m_currentlyConnecting = true;
 }
@@ -410,6 +722,7 @@ void SceneManager::finishConnection() {
 	if (!m_network->m_blocks.empty() && m_network->m_blocks.back().m_name  == Globals::InvisibleLabel)
 		removeBlock(m_network->m_blocks.size()-1);
 
+	setHoveredSocket(SocketHandle());
 	m_currentlyConnecting = false;
 }
 
@@ -440,124 +753,290 @@ const Connector * SceneManager::selectedConnector() const {
 
 
 void SceneManager::addBlock(const Block & block) {
+	if (m_batchDepth > 0) {
+		// block item is created in commitBatch()
+		m_batchBlocks.append(m_network->m_blocks.push_back(block));
+		recordBlockChange(NetworkChangeSet::Added, m_network->m_blocks.back());
+		return;
+	}
 	m_network->m_blocks.push_back(block);
+	recordBlockChange(NetworkChangeSet::Added, m_network->m_blocks.back());
 	BlockItem * item = createBlockItem( m_network->m_blocks.back() );
 	addItem(item);
 	m_blockItems.append(item);
+	m_blockItemIndex.insert(item->m_block, item);
+	// new block may be outside the visible area
+	if (m_virtualized) {
+		extendVirtualSceneRect(QRectF(block.m_pos, block.m_size));
+		updateVisibleArea();
+	}
+	emitNetworkChanged();
 }
 
 
 void SceneManager::addConnector(const Connector & con) {
+	if (m_batchDepth > 0) {
+		// validation, adjustment and item creation is done in commitBatch()
+		ConnectorHandle h = m_network->addConnector(con);
+		m_batchConnectors.append(h);
+		m_batchConnectorSet.insert(h);
+		return;
+	}
 	// first check, that indeed the source/target connectors are valid
-	const Block * b1, * b2;
-	const Socket * s1, * s2;
 	try {
-		m_network->lookupBlockAndSocket(con.m_sourceSocket, b1, s1);
-	} catch (...) {
-		throw std::runtime_error("[SceneManager::addConnector] Invalid source socket identifyer.");
+		m_network->checkConnector(con);
+	} catch (std::runtime_error & e) {
+		throw std::runtime_error(std::string("[SceneManager::addConnector] ") + e.what());
 	}
-	try {
-		m_network->lookupBlockAndSocket(con.m_targetSocket, b2, s2);
-	} catch (...) {
-		throw std::runtime_error("[SceneManager::addConnector] Invalid target socket identifyer.");
-	}
-	if (s1->m_inlet)
-		throw std::runtime_error("[SceneManager::addConnector] Invalid source socket (must be an outlet socket).");
-	if (!s2->m_inlet)
-		throw std::runtime_error("[SceneManager::addConnector] Invalid target socket (must be an inlet socket).");
-	// check, if inlet socket is already connected to
-	if (isConnectedSocket(b2, s2))
-		throw std::runtime_error("[SceneManager::addConnector] Invalid target socket (has already an incoming connection).");
-	m_network->m_connectors.push_back(con);
-	m_network->adjustConnector(m_network->m_connectors.back());
+	ConnectorHandle handle = m_network->addConnector(con);
+	Connector & newCon = *m_network->m_connectors.get(handle);
+	m_network->adjustConnector(newCon);
+	addConnectorItems(newCon);
+	recordConnectorChange(NetworkChangeSet::Added, newCon);
+	emitNetworkChanged();
 }
 
 
 void SceneManager::removeBlock(const Block * block) {
-	size_t idx = 0;
-	for (auto bit = m_network->m_blocks.begin(); bit != m_network->m_blocks.end(); ++bit, ++idx)
-		if (block == &(*bit))
-			break;
-	if (idx == m_network->m_blocks.size())
-		throw std::runtime_error("[SceneManager::removeBlock] Invalid pointer (not in managed network)");
-	removeBlock(idx);
+	removeBlocks(QList<const Block*>() << block);
 }
 
 
 void SceneManager::removeBlock(unsigned int blockIndex) {
 	Q_ASSERT(m_network->m_blocks.size() > blockIndex);
-	Q_ASSERT(m_blockItems.count() > (int)blockIndex);
-
-	auto bit = m_network->m_blocks.begin(); std::advance(bit, blockIndex);
-	Block * blockToBeRemoved = &(*bit);
-
-	// find connectors that connect to this block
-	QSet<Connector*> connectors = m_blockConnectorMap[blockToBeRemoved];
-	for (Connector * con : connectors) {
-		// find connector to be removed from list
-		for (auto cit = m_network->m_connectors.begin(); cit != m_network->m_connectors.end(); ++cit) {
-			if (&(*cit) == con) {
-				m_network->m_connectors.erase(cit);
-				break;
+	removeBlocks(QList<const Block*>() << &m_network->m_blocks[blockIndex]);
+}
+
+
+void SceneManager::removeBlocks(const QList<const Block *> & blocks) {
+	if (blocks.isEmpty())
+		return;
+	QList<BlockHandle> handles;
+	QSet<const Block*> removedBlocks;
+	for (const Block * b : blocks) {
+		BlockHandle h = m_network->blockHandle(b);
+		if (!h.isValid())
+			throw std::runtime_error("[SceneManager::removeBlocks] Invalid pointer (not in managed network)");
+		handles.append(h);
+		removedBlocks.insert(b);
+	}
+
+	// collect all connectors attached to the removed blocks
+	QSet<const Connector*> removedConnectors;
+	for (const BlockHandle & h : qAsConst(handles)) {
+		const QList<ConnectorHandle> cons = m_network->blockConnectors(h);
+		for (const ConnectorHandle & ch : cons)
+			removedConnectors.insert(m_network->m_connectors.get(ch));
+	}
+
+	// remove the block items, large selections in a single pass
+	if (blocks.count() <= Globals::SmallRemovalCount) {
+		for (const Block * b : blocks) {
+			BlockItem * bi = m_blockItemIndex.take(b);
+			if (bi == nullptr)
+				continue; // not shown (virtualized mode or not yet populated)
+			m_blockItems.removeOne(bi);
+			delete bi;
+		}
+	}
+	else {
+		QList<BlockItem*> remainingBlockItems;
+		remainingBlockItems.reserve(m_blockItems.count());
+		for (BlockItem * bi : qAsConst(m_blockItems)) {
+			if (removedBlocks.contains(bi->m_block)) {
+				m_blockItemIndex.remove(bi->m_block);
+				delete bi;
 			}
+			else
+				remainingBlockItems.append(bi);
 		}
+		m_blockItems.swap(remainingBlockItems);
+	}
+	// blocks added in current batch do not have an item yet
+	if (m_batchDepth > 0) {
+		for (const BlockHandle & h : qAsConst(handles))
+			m_batchBlocks.removeOne(h);
 	}
 
-	// now remove the block itself
-	BlockItem * bi = m_blockItems[(int)blockIndex];
-	m_blockItems.removeAt((int)blockIndex);
-	delete bi;
-
-	// finally remove block itself from list
-	m_network->m_blocks.erase(bit);
+	// remove only the segment items of affected connectors
+	for (const Connector * con : qAsConst(removedConnectors))
+		deleteConnectorItems(con);
 
-	// and update all connector items; first remove all, then recreate as needed
-	qDeleteAll(m_connectorSegmentItems); // will be recreated
-	m_connectorSegmentItems.clear();
-	m_blockConnectorMap.clear(); // will be recreated
-	for (Connector & con : m_network->m_connectors) {
-		updateConnectorSegmentItems(con, nullptr);
+	for (const Connector * con : qAsConst(removedConnectors)) {
+		// connectors added in the current batch have not been recorded yet
+		if (m_batchDepth > 0 && m_batchConnectorSet.remove(m_network->connectorHandle(con)))
+			continue;
+		recordConnectorChange(NetworkChangeSet::Removed, *con);
 	}
+	for (const Block * b : blocks)
+		recordBlockChange(NetworkChangeSet::Removed, *b);
+
+	// remove blocks and all connectors that connect to these blocks from network (also updates indexes)
+	m_network->removeBlocks(handles);
+	// scene rect may shrink, in batch mode it is recomputed once in commitBatch()
+	if (m_virtualized) {
+		if (m_batchDepth > 0)
+			m_batchBlocksRemoved = true;
+		else
+			updateVirtualSceneRect();
+	}
+	emitNetworkChanged();
 }
 
 
 void SceneManager::removeConnector(const Connector * con) {
-	size_t idx = 0;
-	for (auto cit = m_network->m_connectors.begin(); cit != m_network->m_connectors.end(); ++cit, ++idx)
-		if (con == &(*cit))
-			break;
-	if (idx == m_network->m_connectors.size())
+	ConnectorHandle h = m_network->connectorHandle(con);
+	if (!h.isValid())
 		throw std::runtime_error("[SceneManager::removeConnector] Invalid pointer (not in managed network)");
-	removeConnector(idx);
+	removeConnector(h);
 }
 
 
 void SceneManager::removeConnector(unsigned int connectorIndex) {
 	Q_ASSERT(m_network->m_connectors.size() > connectorIndex);
+	removeConnector(m_network->m_connectors.handle(connectorIndex));
+}
 
-	auto cit = m_network->m_connectors.begin(); std::advance(cit, connectorIndex);
-	Connector * conToBeRemoved = &(*cit);
 
-	// find corresponding connector items
-	int i=0;
-	while (i<m_connectorSegmentItems.count()) {
-		if (m_connectorSegmentItems[i]->m_connector == conToBeRemoved) {
-			delete m_connectorSegmentItems[i];
-			m_connectorSegmentItems.removeAt(i);
-			continue;
+void SceneManager::removeConnector(const ConnectorHandle & handle) {
+	Connector * conToBeRemoved = m_network->m_connectors.get(handle);
+	// connectors added in the current batch have not been recorded yet, neither is their removal
+	bool batchConnector = m_batchDepth > 0 && m_batchConnectorSet.remove(handle);
+
+	// delete corresponding connector items
+	deleteConnectorItems(conToBeRemoved);
+
+	if (!batchConnector)
+		recordConnectorChange(NetworkChangeSet::Removed, *conToBeRemoved);
+
+	// finally remove connector (also updates adjacency index)
+	m_network->removeConnector(handle);
+	emitNetworkChanged();
+}
+
+
+void SceneManager::renameBlock(const Block * block, const QString & newName) {
+	BlockHandle h = m_network->blockHandle(block);
+	if (!h.isValid())
+		throw std::runtime_error("[SceneManager::renameBlock] Invalid pointer (not in managed network)");
+	QString oldName = block->m_name;
+	m_network->renameBlock(h, newName);
+	// block item picks up the new name when painted
+	BlockItem * item = blockItem(block);
+	if (item != nullptr)
+		item->update();
+	recordBlockChange(NetworkChangeSet::Renamed, *block, QPointF(), oldName);
+	emitNetworkChanged();
+}
+
+
+void SceneManager::beginBatch() {
+	++m_batchDepth;
+}
+
+
+void SceneManager::commitBatch() {
+	Q_ASSERT(m_batchDepth > 0);
+	if (m_batchDepth == 0 || --m_batchDepth > 0)
+		return;
+
+	// validate connectors added during the batch, adjust their segments and remove invalid connectors
+	QStringList errors;
+	QList<ConnectorHandle> newConnectors;
+	for (const ConnectorHandle & h : qAsConst(m_batchConnectors)) {
+		Connector * con = m_network->m_connectors.get(h);
+		if (con == nullptr)
+			continue; // already removed again (together with a block)
+		try {
+			m_network->checkConnector(*con, h);
+			m_network->adjustConnector(*con);
+			newConnectors.append(h);
+		}
+		catch (std::runtime_error & e) {
+			errors.append(QString("Connector '%1': %2").arg(con->m_name, e.what()));
+			m_network->removeConnector(h);
 		}
-		++i;
 	}
 
-	// remove connector associations in block-connector-map
-	for (QMap<const Block*, QSet<Connector*> >::iterator it = m_blockConnectorMap.begin(); it != m_blockConnectorMap.end(); ++it) {
-		QSet<Connector*> & conList = it.value();
-		conList.remove(conToBeRemoved);
+	// create items for all blocks added during the batch - these are at the end of the block list, in the same order
+	for (const BlockHandle & h : qAsConst(m_batchBlocks)) {
+		Block * b = m_network->m_blocks.get(h);
+		Q_ASSERT(b != nullptr);
+		BlockItem * item = createBlockItem(*b);
+		addItem(item);
+		m_blockItems.append(item);
+		m_blockItemIndex.insert(item->m_block, item);
+		if (m_virtualized)
+			extendVirtualSceneRect(QRectF(b->m_pos, b->m_size));
+	}
+
+	// adjust connectors of moved blocks, but only once for each connector
+	QSet<ConnectorHandle> movedConnectors;
+	for (const BlockHandle & bh : qAsConst(m_batchMovedBlocks)) {
+		const QList<ConnectorHandle> cons = m_network->blockConnectors(bh);
+		for (const ConnectorHandle & ch : cons)
+			movedConnectors.insert(ch);
+	}
+	for (const ConnectorHandle & h : qAsConst(newConnectors))
+		movedConnectors.remove(h); // new connectors have been adjusted already
+	for (const ConnectorHandle & h : qAsConst(movedConnectors)) {
+		connectorAboutToMove(*m_network->m_connectors.get(h));
+		m_network->adjustConnector(*m_network->m_connectors.get(h));
+	}
+
+	for (const ConnectorHandle & h : qAsConst(movedConnectors)) {
+		updateConnectorSegmentItems(*m_network->m_connectors.get(h), nullptr);
+		recordConnectorChange(NetworkChangeSet::Moved, *m_network->m_connectors.get(h));
+	}
+	// create items for new connectors
+	for (const ConnectorHandle & h : qAsConst(newConnectors)) {
+		addConnectorItems(*m_network->m_connectors.get(h));
+		recordConnectorChange(NetworkChangeSet::Added, *m_network->m_connectors.get(h));
+	}
+
+	bool geometryChanged = m_batchGeometryChanged;
+	bool blocksRemoved = m_batchBlocksRemoved;
+	QSet<BlockHandle> movedBlocks = m_batchMovedBlocks;
+	clearBatchData();
+	// items for blocks outside the visible area are released again
+	if (m_virtualized) {
+		// added and moved blocks have already extended the scene rect, only removals require a full scan
+		if (blocksRemoved)
+			updateVirtualSceneRect();
+		updateVisibleArea();
+	}
+	if (geometryChanged)
+		emit networkGeometryChanged(movedBlocks, movedConnectors);
+	emitNetworkChanged();
+
+	if (!errors.isEmpty())
+		throw std::runtime_error("[SceneManager::commitBatch] Invalid connectors removed:\n" + errors.join("\n").toStdString());
+}
+
+
+SceneManager::BatchEdit::BatchEdit(SceneManager * sceneManager) :
+	m_sceneManager(sceneManager)
+{
+	m_sceneManager->beginBatch();
+}
+
+
+SceneManager::BatchEdit::~BatchEdit() {
+	try {
+		commit();
+	}
+	catch (std::runtime_error & e) {
+		std::cerr << e.what() << std::endl;
 	}
+}
 
-	// finally remove connector at given index
-	m_network->m_connectors.erase(cit);
 
+void SceneManager::BatchEdit::commit() {
+	if (m_sceneManager == nullptr)
+		return;
+	SceneManager * sceneManager = m_sceneManager;
+	m_sceneManager = nullptr;
+	sceneManager->commitBatch();
 }
 
 
@@ -591,25 +1070,12 @@ void SceneManager::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 	if (m_currentlyConnecting) {
 		if (!m_blockItems.isEmpty() && m_blockItems.back()->block()->m_name == Globals::InvisibleLabel) {
 			QPointF p = m_blockItems.back()->pos();
-			for (BlockItem  * bi : qAsConst(m_blockItems)) {
-				if (bi->block()->m_name == Globals::InvisibleLabel)
-					continue;
-				// first un-hover all sockets
-				for (SocketItem * si : qAsConst(bi->m_socketItems)) {
-					si->m_hovered = false;
-					si->update();
-				}
-
-				// now search for sockets that may be hovered
-				SocketItem * si = bi->inletSocketAcceptingConnection(p);
-				if (si != nullptr) {
-					// only allow hovering for sockets without connection
-					if (!isConnectedSocket(bi->block(), si->socket())) {
-						si->m_hovered = true;
-						si->update();
-					}
-				}
-			}
+			// search for the inlet socket in snapping distance (half grid spacing), only sockets without
+			// connection can be hovered
+			SocketHandle sh = m_network->nearestSocket(p, Globals::GridSpacing/2, true);
+			if (sh.isValid() && m_network->isConnectedSocket(sh))
+				sh = SocketHandle();
+			setHoveredSocket(sh);
 		}
 	}
 
@@ -620,6 +1086,14 @@ void SceneManager::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 void SceneManager::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 
 	QGraphicsScene::mouseReleaseEvent(mouseEvent);
+	// dragging has ended, update connectors and show all items normally again
+	if (mouseGrabberItem() == nullptr) {
+		finishDragSession();
+		finishInteraction();
+		// following moves start a new undo step
+		if (!m_undoStack.isEmpty())
+			m_undoStack.last().m_open = false;
+	}
 	if (mouseEvent->button() & Qt::LeftButton) {
 		QString startSocket;
 		QString targetSocket;
@@ -628,21 +1102,15 @@ void SceneManager::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 		if (m_currentlyConnecting) {
 			if (!m_blockItems.isEmpty() && m_blockItems.back()->block()->m_name == Globals::InvisibleLabel) {
 				QPointF p = m_blockItems.back()->pos();
-				for (BlockItem  * bi : qAsConst(m_blockItems)) {
-					if (bi->block()->m_name == Globals::InvisibleLabel)
-						continue;
-
-					// now search for sockets that may be hovered
-					SocketItem * si = bi->inletSocketAcceptingConnection(p);
-					if (si != nullptr) {
-						// only allow hovering for sockets without connection
-						if (!isConnectedSocket(bi->block(), si->socket())) {
-							// found one - remember this socket and the starting socket for our connection
-							startSocket = m_network->m_connectors.back().m_sourceSocket;
-							targetSocket = bi->block()->m_name + "." + si->socket()->m_name;
-							break;
-						}
-					}
+				SocketHandle sh = m_network->nearestSocket(p, Globals::GridSpacing/2, true);
+				// only allow connections to sockets without connection
+				if (sh.isValid() && !m_network->isConnectedSocket(sh)) {
+					// found one - remember this socket and the starting socket for our connection
+					const Block * block;
+					const Socket * socket;
+					m_network->lookupBlockAndSocket(sh, block, socket);
+					startSocket = m_network->sourceSocketName(m_network->m_connectors.back());
+					targetSocket = block->m_name + "." + socket->m_name;
 				}
 			}
 		}
@@ -658,6 +1126,8 @@ void SceneManager::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 			m_network->m_connectors.push_back(con);
 			m_network->adjustConnector(m_network->m_connectors.back());
 			updateConnectorSegmentItems(m_network->m_connectors.back(), nullptr);
+			recordConnectorChange(NetworkChangeSet::Added, m_network->m_connectors.back());
+			emitNetworkChanged();
 			emit newConnectionAdded();
 		}
 		else {
@@ -669,10 +1139,14 @@ void SceneManager::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 					break;
 				}
 			}
-			for (const ConnectorSegmentItem *item: qAsConst(m_connectorSegmentItems)) {
-				if (item->isSelected()) {
-					blockOrConnectorSelected = true;
+			for (const ConnectorItems & items : qAsConst(m_connectorItems)) {
+				if (blockOrConnectorSelected)
 					break;
+				for (const ConnectorSegmentItem *item: items.allItems()) {
+					if (item->isSelected()) {
+						blockOrConnectorSelected = true;
+						break;
+					}
 				}
 			}
 			if (!blockOrConnectorSelected)
@@ -682,6 +1156,28 @@ void SceneManager::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent) {
 }
 
 
+void SceneManager::drawItems(QPainter *painter, int numItems, QGraphicsItem *items[],
+							 const QStyleOptionGraphicsItem options[], QWidget *widget)
+{
+	if (m_layerFilter == AllLayers) {
+		QGraphicsScene::drawItems(painter, numItems, items, options, widget);
+		return;
+	}
+	// keep only the items of the requested layer, together with their style options
+	QVector<QGraphicsItem*> layerItems;
+	QVector<QStyleOptionGraphicsItem> layerOptions;
+	bool live = (m_layerFilter == LiveLayer);
+	for (int i=0; i<numItems; ++i) {
+		if (isLiveItem(items[i]) == live) {
+			layerItems.append(items[i]);
+			layerOptions.append(options[i]);
+		}
+	}
+	if (!layerItems.isEmpty())
+		QGraphicsScene::drawItems(painter, layerItems.count(), layerItems.data(), layerOptions.constData(), widget);
+}
+
+
 BlockItem * SceneManager::createBlockItem(Block & b) {
 	BlockItem * item = new BlockItem(&b);
 	item->setRect(0,0,b.m_size.width(), b.m_size.height());
@@ -702,27 +1198,26 @@ QList<ConnectorSegmentItem *> SceneManager::createConnectorItems(Connector & con
 	// them the properties to be painted appropriately
 
 	try {
-		const Socket * socket;
-		const Block * block;
-		m_network->lookupBlockAndSocket(con.m_sourceSocket, block, socket);
-		m_blockConnectorMap[block].insert(&con); // remember association
-		// get start line coordinates: first point is the socket's center, second point is the connection point outside the socket
-		QLineF startLine = block->socketStartLine(socket);
-		// get end line coordinates: first point is the socket's center, second point is the connection point outside the socket
-		m_network->lookupBlockAndSocket(con.m_targetSocket, block, socket);
-		m_blockConnectorMap[block].insert(&con); // remember association
-		QLineF endLine = block->socketStartLine(socket);
+		QLineF startLine, endLine;
+		connectorLines(con, startLine, endLine);
+
+		if (m_connectorItemMode == PathItems) {
+			ConnectorPathItem * item = createConnectorPathItem(con);
+			newConns.append(item);
+			item->setConnectorLines(startLine, endLine);
+			return newConns;
+		}
 
 		ConnectorSegmentItem * item = createConnectorItem(con);
 		item->setLine(startLine);
 		item->setFlags(QGraphicsItem::ItemIsSelectable);
-		item->m_segmentIdx = -1; // start line
+		item->setSegmentIndex(-1); // start line
 		newConns.append(item);
 
 		item = createConnectorItem(con);
 		item->setLine(endLine);
 		item->setFlags(QGraphicsItem::ItemIsSelectable);
-		item->m_segmentIdx = -2; // end line
+		item->setSegmentIndex(-2); // end line
 		newConns.append(item);
 
 		QPointF start = startLine.p2();
@@ -735,7 +1230,7 @@ QList<ConnectorSegmentItem *> SceneManager::createConnectorItems(Connector & con
 			else
 				next += QPointF(0, seg.m_offset);
 			item->setLine(QLineF(start, next));
-			item->m_segmentIdx = i; // regular line segment
+			item->setSegmentIndex(i); // regular line segment
 			newConns.append(item);
 			start = next;
 		}
@@ -752,6 +1247,24 @@ QList<ConnectorSegmentItem *> SceneManager::createConnectorItems(Connector & con
 }
 
 
+ConnectorPathItem * SceneManager::createConnectorPathItem(Connector & con) {
+	ConnectorPathItem * item = new ConnectorPathItem(&con);
+	return item;
+}
+
+
+void SceneManager::setConnectorItemMode(ConnectorItemMode mode) {
+	if (mode == m_connectorItemMode)
+		return;
+	m_connectorItemMode = mode;
+	// re-create items of all connectors currently shown in the scene
+	const QList<const Connector*> cons = m_connectorItems.keys();
+	clearConnectorItems();
+	for (const Connector * con : cons)
+		addConnectorItems(const_cast<Connector&>(*con)); // const-cast is safe here, since we only expect connector objects that we own ourselves
+}
+
+
 void SceneManager::onSelectionChanged() {
 	// get newly selected items, and if a connector is part of the selection, select *all* segments of the same collector,
 	// but deselect all others
@@ -778,13 +1291,12 @@ void SceneManager::onSelectionChanged() {
 //		disconnect(this, &SceneManager::selectionChanged, this, &SceneManager::onSelectionChanged);
 		clearSelection();
 		// now select all items that belong to the connector
-		for (ConnectorSegmentItem * item : m_connectorSegmentItems) {
-			if (item->m_connector == selectedCons.back())
-				item->setSelected(true);
-		}
+		const QList<ConnectorSegmentItem*> conItems = m_connectorItems.value(selectedCons.back()).allItems();
+		for (ConnectorSegmentItem * item : conItems)
+			item->setSelected(true);
 //		connect(this, &SceneManager::selectionChanged, this, &SceneManager::onSelectionChanged);
 		// signal that our connection was selected
-		emit newConnectorSelected(selectedCons[0]->m_sourceSocket, selectedCons[0]->m_targetSocket);
+		emit newConnectorSelected(m_network->sourceSocketName(*selectedCons[0]), m_network->targetSocketName(*selectedCons[0]));
 	}
 }
 
@@ -794,33 +1306,610 @@ void SceneManager::blockDoubleClicked(const BlockItem * blockItem) {
 }
 
 
-void SceneManager::updateConnectorSegmentItems(const Connector & con, ConnectorSegmentItem * currentItem) {
-	// lookup corresponding connectorItems
-	ConnectorSegmentItem*	startSegment = nullptr;
-	ConnectorSegmentItem*	endSegment = nullptr;
-	QList<ConnectorSegmentItem*> segmentItems;
-	for (ConnectorSegmentItem* segmentItem : qAsConst(m_connectorSegmentItems)) {
-		if (segmentItem->m_connector == &con) {
-			if (segmentItem->m_segmentIdx == -1)
-				startSegment = segmentItem;
-			else if (segmentItem->m_segmentIdx == -2)
-				endSegment = segmentItem;
+void SceneManager::connectorLines(const Connector & con, QLineF & startLine, QLineF & endLine) const {
+	const Socket * socket;
+	const Block * block;
+	m_network->lookupSourceSocket(con, block, socket);
+	// get start line coordinates: first point is the socket's center, second point is the connection point outside the socket
+	startLine = block->socketStartLine(socket);
+	// get end line coordinates: first point is the socket's center, second point is the connection point outside the socket
+	m_network->lookupTargetSocket(con, block, socket);
+	endLine = block->socketStartLine(socket);
+}
+
+
+void SceneManager::addConnectorItems(Connector & con) {
+	QList<ConnectorSegmentItem *> newConns = createConnectorItems(con);
+	for (ConnectorSegmentItem * item : qAsConst(newConns))
+		addConnectorSegmentItem(item);
+}
+
+
+void SceneManager::addConnectorSegmentItem(ConnectorSegmentItem * item) {
+	addItem(item);
+	ConnectorItems & items = m_connectorItems[item->m_connector];
+	if (item->m_segmentIdx == ConnectorPathItem::PathSegmentIdx)
+		items.m_pathItem = static_cast<ConnectorPathItem*>(item);
+	else if (item->m_segmentIdx == -1)
+		items.m_startItem = item;
+	else if (item->m_segmentIdx == -2)
+		items.m_endItem = item;
+	else {
+		Q_ASSERT(item->m_segmentIdx >= 0);
+		while (items.m_segmentItems.count() <= item->m_segmentIdx)
+			items.m_segmentItems.append(nullptr);
+		items.m_segmentItems[item->m_segmentIdx] = item;
+	}
+}
+
+
+void SceneManager::deleteConnectorItems(const Connector * con) {
+	QHash<const Connector*, ConnectorItems>::iterator it = m_connectorItems.find(con);
+	if (it == m_connectorItems.end())
+		return;
+	qDeleteAll(it.value().allItems());
+	m_connectorItems.erase(it);
+}
+
+
+void SceneManager::clearConnectorItems() {
+	for (const ConnectorItems & items : qAsConst(m_connectorItems))
+		qDeleteAll(items.allItems());
+	m_connectorItems.clear();
+}
+
+
+QList<ConnectorSegmentItem*> SceneManager::ConnectorItems::allItems() const {
+	QList<ConnectorSegmentItem*> items;
+	items.reserve(m_segmentItems.count() + 3);
+	if (m_pathItem != nullptr)
+		items.append(m_pathItem);
+	if (m_startItem != nullptr)
+		items.append(m_startItem);
+	if (m_endItem != nullptr)
+		items.append(m_endItem);
+	for (ConnectorSegmentItem * item : m_segmentItems)
+		if (item != nullptr)
+			items.append(item);
+	return items;
+}
+
+
+void SceneManager::setNetworkData(Network && network) {
+	*m_network = std::move(network);
+	// connectors reference sockets via socket handles from now on
+	m_network->resolveConnectors();
+
+	qDeleteAll(m_blockItems);
+	m_blockItems.clear();
+	m_blockItemIndex.clear();
+	clearConnectorItems();
+	// all data is shown now, pending batch data is obsolete
+	clearBatchData();
+	// stop any running incremental population
+	m_pendingItems.clear();
+	m_pendingItemPos = 0;
+	m_populationTimer->stop();
+
+	// initially, we are not in connection mode
+	m_currentlyConnecting = false;
+	m_hoveredSocket = SocketHandle();
+	// items of an active interaction are gone
+	finishInteraction();
+	m_dragSessionActive = false;
+	m_dragMovedBlocks.clear();
+	m_dragTimer->stop();
+	// previous changes are obsolete, consumers must re-read the entire network
+	m_changes.clear();
+	m_changes.m_reset = true;
+	if (m_undoEnabled)
+		clearUndoStack();
+	// next snapshot copies the entire network
+	m_snapshot = NetworkSnapshot();
+	m_snapshotValid = false;
+	m_snapshotBlocks.clear();
+	m_snapshotConnectors.clear();
+
+	if (m_virtualized)
+		updateVirtualSceneRect();
+}
+
+
+void SceneManager::populateItems(int timeBudget) {
+	QElapsedTimer timer;
+	timer.start();
+	while (m_pendingItemPos < m_pendingItems.count()) {
+		const PendingItem & p = m_pendingItems.at(m_pendingItemPos++);
+		if (p.m_block.isValid()) {
+			Block * b = m_network->m_blocks.get(p.m_block);
+			if (b != nullptr) { // nullptr if removed meanwhile
+				BlockItem * item = createBlockItem(*b);
+				addItem(item);
+				m_blockItems.append(item);
+				m_blockItemIndex.insert(item->m_block, item);
+			}
+		}
+		else {
+			Connector * con = m_network->m_connectors.get(p.m_connector);
+			// skip removed connectors and connectors whose items were created already when a block was moved
+			if (con != nullptr && !m_connectorItems.contains(con))
+				addConnectorItems(*con);
+		}
+		// query timer only every few items
+		if (timeBudget >= 0 && m_pendingItemPos % 16 == 0 && timer.elapsed() >= timeBudget)
+			return;
+	}
+	m_pendingItems.clear();
+	m_pendingItemPos = 0;
+	m_populationTimer->stop();
+	emit populationFinished();
+}
+
+
+void SceneManager::updateVirtualizedItems() {
+	if (!m_virtualized)
+		return;
+	// without views, no items are needed
+	QRectF region = visibleRegion();
+	QGraphicsItem * grabber = mouseGrabberItem();
+
+	// blocks in the visible area, those without item are left in the set afterwards
+	const QList<BlockHandle> visibleBlocks = region.isNull() ? QList<BlockHandle>() : m_network->blocksInRect(region);
+	QSet<const Block*> blocksWithoutItem;
+	blocksWithoutItem.reserve(visibleBlocks.count());
+	for (const BlockHandle & h : visibleBlocks)
+		blocksWithoutItem.insert(m_network->m_blocks.get(h));
+
+	// move items of hidden blocks into the pool, but keep selected items, the item being dragged
+	// and the connection helper block
+	QList<BlockItem*> remainingBlockItems;
+	for (BlockItem * bi : qAsConst(m_blockItems)) {
+		if (blocksWithoutItem.remove(bi->m_block) || bi->isSelected() || bi == grabber ||
+			bi->m_block->m_connectionHelperBlock)
+		{
+			remainingBlockItems.append(bi);
+		}
+		else {
+			removeItem(bi);
+			m_blockItemIndex.remove(bi->m_block);
+			m_blockItemPool.append(bi);
+		}
+	}
+	m_blockItems.swap(remainingBlockItems);
+	for (const BlockHandle & h : visibleBlocks) {
+		Block * b = m_network->m_blocks.get(h);
+		if (!blocksWithoutItem.contains(b))
+			continue;
+		BlockItem * item;
+		if (!m_blockItemPool.isEmpty()) {
+			item = m_blockItemPool.takeLast();
+			item->setBlock(b);
+		}
+		else
+			item = createBlockItem(*b);
+		addItem(item);
+		m_blockItems.append(item);
+		m_blockItemIndex.insert(item->m_block, item);
+	}
+	// the pool need not be larger than the number of shown items
+	while (m_blockItemPool.count() > m_blockItems.count())
+		delete m_blockItemPool.takeLast();
+
+	// connectors in the visible area
+	const QList<ConnectorHandle> visibleConnectors = region.isNull() ? QList<ConnectorHandle>() : m_network->connectorsInRect(region);
+	QSet<const Connector*> connectorsWithoutItems;
+	connectorsWithoutItems.reserve(visibleConnectors.count());
+	for (const ConnectorHandle & h : visibleConnectors)
+		connectorsWithoutItems.insert(m_network->m_connectors.get(h));
+	QList<const Connector*> hiddenConnectors;
+	for (QHash<const Connector*, ConnectorItems>::const_iterator it = m_connectorItems.constBegin();
+		 it != m_connectorItems.constEnd(); ++it)
+	{
+		if (connectorsWithoutItems.remove(it.key()))
+			continue;
+		bool keep = false;
+		for (const ConnectorSegmentItem * item : it.value().allItems())
+			keep = keep || item->isSelected() || item == grabber;
+		if (!keep)
+			hiddenConnectors.append(it.key());
+	}
+	for (const Connector * con : qAsConst(hiddenConnectors))
+		deleteConnectorItems(con);
+	for (const ConnectorHandle & h : visibleConnectors) {
+		Connector * con = m_network->m_connectors.get(h);
+		if (connectorsWithoutItems.contains(con))
+			addConnectorItems(*con);
+	}
+	// items were created or removed in the visible area
+	if (!m_liveBlocks.isEmpty())
+		staticLayerChanged(region);
+}
+
+
+QRectF SceneManager::visibleRegion() const {
+	QRectF region;
+	for (const QGraphicsView * view : views()) {
+		QRectF r = view->mapToScene(view->viewport()->rect()).boundingRect();
+		region = region.isNull() ? r : region.united(r);
+	}
+	// margin, so that small pans do not require new items
+	return region.adjusted(-0.5*region.width(), -0.5*region.height(), 0.5*region.width(), 0.5*region.height());
+}
+
+
+void SceneManager::updateVirtualSceneRect() {
+	QRectF r;
+	for (const Block & b : m_network->m_blocks)
+		r = r.united(QRectF(b.m_pos, b.m_size));
+	double margin = 10*Globals::GridSpacing;
+	setSceneRect(r.adjusted(-margin, -margin, margin, margin));
+}
+
+
+void SceneManager::extendVirtualSceneRect(const QRectF & blockRect) {
+	double margin = 10*Globals::GridSpacing;
+	QRectF r = blockRect.adjusted(-margin, -margin, margin, margin);
+	if (!sceneRect().contains(r))
+		setSceneRect(sceneRect().united(r));
+}
+
+
+SocketItem * SceneManager::socketItemAt(const SocketHandle & socket) const {
+	const Block * b;
+	const Socket * s;
+	try {
+		m_network->lookupBlockAndSocket(socket, b, s);
+	}
+	catch (...) {
+		return nullptr;
+	}
+	// socket items are small and centered at the socket position
+	QPointF p = b->m_pos + s->m_pos;
+	const QList<QGraphicsItem*> candidates = items(QRectF(p.x()-1, p.y()-1, 2, 2));
+	for (QGraphicsItem * item : candidates) {
+		SocketItem * si = dynamic_cast<SocketItem*>(item);
+		if (si != nullptr && si->socket() == s)
+			return si;
+	}
+	return nullptr;
+}
+
+
+void SceneManager::setHoveredSocket(const SocketHandle & socket) {
+	if (socket == m_hoveredSocket)
+		return;
+	SocketItem * si = socketItemAt(m_hoveredSocket);
+	if (si != nullptr) {
+		si->m_hovered = false;
+		si->update();
+		// in two-layer mode, the socket is part of the cached static layer
+		if (isInteractionActive())
+			staticLayerChanged(si->sceneBoundingRect());
+	}
+	m_hoveredSocket = socket;
+	si = socketItemAt(m_hoveredSocket);
+	if (si != nullptr) {
+		si->m_hovered = true;
+		si->update();
+		if (isInteractionActive())
+			staticLayerChanged(si->sceneBoundingRect());
+	}
+}
+
+
+void SceneManager::startInteraction(const BlockItem * grabber) {
+	// selected blocks are moved together with the grabbed block
+	m_liveBlocks.insert(grabber->block());
+	const QList<QGraphicsItem *> selection = selectedItems();
+	for (const QGraphicsItem * item : selection) {
+		const BlockItem * bi = dynamic_cast<const BlockItem *>(item);
+		if (bi != nullptr)
+			m_liveBlocks.insert(bi->block());
+	}
+	// attached connectors are adjusted while dragging
+	for (const Block * b : qAsConst(m_liveBlocks)) {
+		const QList<ConnectorHandle> cons = m_network->blockConnectors(m_network->blockHandle(b));
+		for (const ConnectorHandle & ch : cons)
+			m_liveConnectors.insert(m_network->m_connectors.get(ch));
+	}
+	// views detect the start of the interaction themselves when repainting
+	update();
+}
+
+
+void SceneManager::finishInteraction() {
+	if (m_liveBlocks.isEmpty())
+		return;
+	m_liveBlocks.clear();
+	m_liveConnectors.clear();
+	update();
+}
+
+
+void SceneManager::flushDragUpdates() {
+	m_dragTimer->stop();
+	if (m_dragMovedBlocks.isEmpty())
+		return;
+	QSet<BlockHandle> movedBlocks;
+	movedBlocks.swap(m_dragMovedBlocks);
+	// collect connectors of all moved blocks, connectors between two moved blocks are adjusted only once
+	QSet<ConnectorHandle> changedConnectors;
+	for (const BlockHandle & bh : qAsConst(movedBlocks)) {
+		const QList<ConnectorHandle> cons = m_network->blockConnectors(bh);
+		for (const ConnectorHandle & ch : cons)
+			changedConnectors.insert(ch);
+	}
+	for (const ConnectorHandle & ch : qAsConst(changedConnectors)) {
+		Connector * con = m_network->m_connectors.get(ch);
+		if (con == nullptr)
+			continue; // removed during the drag
+		connectorAboutToMove(*con);
+		m_network->adjustConnector(*con);
+		updateConnectorSegmentItems(*con, nullptr);
+		recordConnectorChange(NetworkChangeSet::Moved, *con);
+	}
+	// Rule: never ever call setNetwork() when processing this signal (see blockMoved())!
+	emit networkGeometryChanged(movedBlocks, changedConnectors);
+	emitNetworkChanged();
+}
+
+
+void SceneManager::finishDragSession() {
+	if (!m_dragSessionActive)
+		return;
+	m_dragSessionActive = false;
+	flushDragUpdates();
+}
+
+
+void SceneManager::recordBlockChange(NetworkChangeSet::ChangeType type, const Block & block,
+									 const QPointF & oldPos, const QString & oldName)
+{
+	if (block.m_connectionHelperBlock)
+		return;
+	BlockHandle h = m_network->blockHandle(&block);
+	m_changes.addBlockChange(type, h, block.m_name, oldPos, oldName);
+	blockChangedForSnapshot(h, type == NetworkChangeSet::Added || type == NetworkChangeSet::Removed);
+	if (m_undoEnabled && !m_applyingUndo)
+		m_undoStep.recordBlock(type, h, block, oldPos, oldName);
+}
+
+
+void SceneManager::recordConnectorChange(NetworkChangeSet::ChangeType type, const Connector & con) {
+	if (con.m_name == Globals::InvisibleLabel)
+		return;
+	ConnectorHandle h = m_network->connectorHandle(&con);
+	QString sourceSocket = m_network->sourceSocketName(con);
+	QString targetSocket = m_network->targetSocketName(con);
+	m_changes.addConnectorChange(type, h, con.m_name, sourceSocket, targetSocket);
+	connectorChangedForSnapshot(h, type == NetworkChangeSet::Added || type == NetworkChangeSet::Removed);
+	if (m_undoEnabled && !m_applyingUndo)
+		m_undoStep.recordConnector(type, h, con, sourceSocket, targetSocket);
+}
+
+
+void SceneManager::emitNetworkChanged() {
+	if (m_batchDepth > 0 || m_applyingUndo)
+		return;
+	pushUndoStep();
+	if (m_changes.isEmpty())
+		return;
+	NetworkChangeSet changes;
+	std::swap(changes, m_changes);
+	emit networkChanged(changes);
+}
+
+
+void SceneManager::pushUndoStep() {
+	UndoStep step;
+	std::swap(step, m_undoStep);
+	if (step.isEmpty())
+		return;
+	step.finish(*m_network);
+	// steps recorded while dragging are merged with the following move steps
+	step.m_open = (mouseGrabberItem() != nullptr);
+	if (!m_undoStack.isEmpty() && m_undoStack.last().m_open && step.isMoveOnly()) {
+		m_undoStack.last().merge(step);
+		m_undoStack.last().m_open = step.m_open;
+	}
+	else {
+		if (!m_undoStack.isEmpty())
+			m_undoStack.last().m_open = false;
+		m_undoStack.append(step);
+		while (m_undoStack.count() > m_undoLimit)
+			m_undoStack.removeFirst();
+	}
+	m_redoStack.clear();
+	emit undoStackChanged();
+}
+
+
+void SceneManager::applyUndoStep(const UndoStep & step, bool undo) {
+	// deltas of the step's type 'removeType' are reverted by removing the entity, those of 'addType'
+	// by re-creating it; undo processes the deltas in reverse order
+	const NetworkChangeSet::ChangeType removeType = undo ? NetworkChangeSet::Added : NetworkChangeSet::Removed;
+	const NetworkChangeSet::ChangeType addType = undo ? NetworkChangeSet::Removed : NetworkChangeSet::Added;
+	const int conCount = step.m_connectorDeltas.count();
+	const int blockCount = step.m_blockDeltas.count();
+	QSet<BlockHandle> movedBlocks;
+	QSet<ConnectorHandle> changedConnectors;
+
+	m_applyingUndo = true;
+	try {
+		// remove connectors first, so that removed blocks are no longer referenced
+		for (int i=0; i<conCount; ++i) {
+			const UndoStep::ConnectorDelta & d = step.m_connectorDeltas[undo ? conCount-1-i : i];
+			if (d.m_type != removeType)
+				continue;
+			const Connector * con = m_network->m_connectors.get(undoConnectorHandle(d.m_connector));
+			if (con != nullptr)
+				removeConnector(con);
+		}
+
+		for (int i=0; i<blockCount; ++i) {
+			const UndoStep::BlockDelta & d = step.m_blockDeltas[undo ? blockCount-1-i : i];
+			BlockHandle h = undoBlockHandle(d.m_block);
+			if (d.m_type == NetworkChangeSet::Moved) {
+				moveBlockTo(h, undo ? d.m_oldPos : d.m_newPos);
+				movedBlocks.insert(h);
+			}
+			else if (d.m_type == NetworkChangeSet::Renamed) {
+				const Block * b = m_network->m_blocks.get(h);
+				if (b != nullptr)
+					renameBlock(b, undo ? d.m_oldName : d.m_newName);
+			}
+			else if (d.m_type == removeType) {
+				const Block * b = m_network->m_blocks.get(h);
+				if (b != nullptr)
+					removeBlock(b);
+			}
 			else {
-				if (currentItem == nullptr || segmentItem != currentItem)
-					segmentItems.append(segmentItem);
+				addBlock(d.m_data);
+				m_undoBlockHandles[h] = m_network->m_blocks.handle(m_network->m_blocks.size()-1);
 			}
 		}
+
+		// re-create connectors and restore segments, once all blocks are in place
+		for (int i=0; i<conCount; ++i) {
+			const UndoStep::ConnectorDelta & d = step.m_connectorDeltas[undo ? conCount-1-i : i];
+			ConnectorHandle h = undoConnectorHandle(d.m_connector);
+			if (d.m_type == NetworkChangeSet::Moved) {
+				Connector * con = m_network->m_connectors.get(h);
+				if (con == nullptr)
+					continue;
+				if (d.m_hasSegments)
+					con->m_segments = undo ? d.m_oldSegments : d.m_newSegments;
+				else
+					m_network->adjustConnector(*con);
+				updateConnectorSegmentItems(*con, nullptr);
+				m_network->connectorGeometryChanged(h);
+				recordConnectorChange(NetworkChangeSet::Moved, *con);
+				changedConnectors.insert(h);
+			}
+			else if (d.m_type == addType) {
+				addConnector(d.m_data);
+				ConnectorHandle newHandle = m_network->m_connectors.handle(m_network->m_connectors.size()-1);
+				m_undoConnectorHandles[h] = newHandle;
+				// addConnector() adjusts the connector, restore the original segments
+				Connector * con = m_network->m_connectors.get(newHandle);
+				con->m_segments = d.m_data.m_segments;
+				updateConnectorSegmentItems(*con, nullptr);
+				m_network->connectorGeometryChanged(newHandle);
+			}
+		}
+	}
+	catch (...) {
+		m_applyingUndo = false;
+		// report the changes applied so far
+		emitNetworkChanged();
+		throw;
+	}
+	m_applyingUndo = false;
+
+	if (!movedBlocks.isEmpty() || !changedConnectors.isEmpty())
+		emit networkGeometryChanged(movedBlocks, changedConnectors);
+	emitNetworkChanged();
+}
+
+
+void SceneManager::moveBlockTo(const BlockHandle & handle, const QPointF & pos) {
+	Block * b = m_network->m_blocks.get(handle);
+	if (b == nullptr || b->m_pos == pos)
+		return;
+	QPointF oldPos = b->m_pos;
+	b->m_pos = pos;
+	// block position is already up-to-date, so the item does not call blockMoved()
+	BlockItem * item = blockItem(b);
+	if (item != nullptr)
+		item->setPos(pos);
+	m_network->blockGeometryChanged(handle);
+	recordBlockChange(NetworkChangeSet::Moved, *b, oldPos);
+	if (m_virtualized) {
+		extendVirtualSceneRect(QRectF(pos, b->m_size));
+		updateVisibleArea();
+	}
+}
+
+
+void SceneManager::blockChangedForSnapshot(const BlockHandle & handle, bool orderChanged) {
+	if (!m_snapshotValid)
+		return;
+	m_snapshotBlocks.insert(handle);
+	if (orderChanged)
+		m_snapshotOrderChanged = true;
+}
+
+
+void SceneManager::connectorChangedForSnapshot(const ConnectorHandle & handle, bool orderChanged) {
+	if (!m_snapshotValid)
+		return;
+	m_snapshotConnectors.insert(handle);
+	if (orderChanged)
+		m_snapshotOrderChanged = true;
+}
+
+
+BlockHandle SceneManager::undoBlockHandle(BlockHandle handle) const {
+	QHash<BlockHandle, BlockHandle>::const_iterator it;
+	while ((it = m_undoBlockHandles.constFind(handle)) != m_undoBlockHandles.constEnd())
+		handle = it.value();
+	return handle;
+}
+
+
+ConnectorHandle SceneManager::undoConnectorHandle(ConnectorHandle handle) const {
+	QHash<ConnectorHandle, ConnectorHandle>::const_iterator it;
+	while ((it = m_undoConnectorHandles.constFind(handle)) != m_undoConnectorHandles.constEnd())
+		handle = it.value();
+	return handle;
+}
+
+
+void SceneManager::staticLayerChanged(const QRectF & rect) {
+	for (QGraphicsView * view : views()) {
+		ZoomMeshGraphicsView * zoomView = qobject_cast<ZoomMeshGraphicsView *>(view);
+		if (zoomView != nullptr)
+			zoomView->invalidateLayerCache(rect);
 	}
-	// re-create entire connector if all pointers are emtpy
-	if (startSegment == nullptr && endSegment == nullptr && segmentItems.isEmpty()) {
-		QList<ConnectorSegmentItem *> newConns = createConnectorItems(const_cast<Connector&>(con)); // const-cast is safe here, since we only expect connector objects that we own ourselves
-		for( BLOCKMOD::ConnectorSegmentItem * item : qAsConst(newConns)) {
-			addItem(item);
-			m_connectorSegmentItems.append(item);
-//			qDebug() << item << " : " << item->m_connector << " : " << item->m_segmentIdx << " : " << item->line();
+}
+
+
+void SceneManager::clearBatchData() {
+	m_batchBlocks.clear();
+	m_batchConnectors.clear();
+	m_batchConnectorSet.clear();
+	m_batchMovedBlocks.clear();
+	m_batchGeometryChanged = false;
+	m_batchBlocksRemoved = false;
+}
+
+
+void SceneManager::updateConnectorSegmentItems(const Connector & con, ConnectorSegmentItem * currentItem) {
+	// lookup corresponding connectorItems
+	QHash<const Connector*, ConnectorItems>::iterator it = m_connectorItems.find(&con);
+	// re-create entire connector if there are no items yet
+	if (it == m_connectorItems.end()) {
+		addConnectorItems(const_cast<Connector&>(con)); // const-cast is safe here, since we only expect connector objects that we own ourselves
+		return;
+	}
+	// path items only need to rebuild their cached path
+	if (it.value().m_pathItem != nullptr) {
+		try {
+			QLineF startLine, endLine;
+			connectorLines(con, startLine, endLine);
+			it.value().m_pathItem->setConnectorLines(startLine, endLine);
+		} catch (...) {
+			// error handling
 		}
 		return;
 	}
+	ConnectorSegmentItem*	startSegment = it.value().m_startItem;
+	ConnectorSegmentItem*	endSegment = it.value().m_endItem;
+	QList<ConnectorSegmentItem*> segmentItems;
+	for (ConnectorSegmentItem* segmentItem : qAsConst(it.value().m_segmentItems)) {
+		if (segmentItem != nullptr && segmentItem != currentItem)
+			segmentItems.append(segmentItem);
+	}
 	Q_ASSERT(startSegment != nullptr);
 	Q_ASSERT(endSegment != nullptr);
 	// segmentItems now contains all segment items matching this connected, except the currentItem
@@ -831,7 +1920,6 @@ void SceneManager::updateConnectorSegmentItems(const Connector & con, ConnectorS
 	// remove any superfluous segment items
 	while (segmentItems.count() > itemsNeeded) {
 		ConnectorSegmentItem* segmentItem = segmentItems.back();
-		m_connectorSegmentItems.removeOne(segmentItem);
 		delete segmentItem;
 		segmentItems.pop_back();
 	}
@@ -847,7 +1935,6 @@ void SceneManager::updateConnectorSegmentItems(const Connector & con, ConnectorS
 		ConnectorSegmentItem * item = createConnectorItem(const_cast<Connector&>(con)); // need to get write access for connector in newly created item
 		item->m_isHighlighted = highlighted;
 		addItem(item);
-		m_connectorSegmentItems.append(item);
 		segmentItems.append(item);
 	}
 
@@ -858,21 +1945,17 @@ void SceneManager::updateConnectorSegmentItems(const Connector & con, ConnectorS
 	}
 
 	Q_ASSERT(segmentItems.count() == con.m_segments.count());
+	// segment items are stored in segment order (indexes are updated below)
+	it.value().m_segmentItems = segmentItems;
 
 	// now process all segment items
 	try {
 		// first start and end segments
-		const Socket * socket;
-		const Block * block;
-		m_network->lookupBlockAndSocket(con.m_sourceSocket, block, socket);
-		// get start line coordinates: first point is the socket's center, second point is the connection point outside the socket
-		QLineF startLine = block->socketStartLine(socket);
+		QLineF startLine, endLine;
+		connectorLines(con, startLine, endLine);
 		QPointF pos = startSegment->pos();
 		startLine.translate(-pos);
 		startSegment->setLine(startLine);
-		// get end line coordinates: first point is the socket's center, second point is the connection point outside the socket
-		m_network->lookupBlockAndSocket(con.m_targetSocket, block, socket);
-		QLineF endLine = block->socketStartLine(socket);
 		pos = endSegment->pos();
 		endLine.translate(-pos);
 		endSegment->setLine(endLine);
@@ -893,14 +1976,12 @@ void SceneManager::updateConnectorSegmentItems(const Connector & con, ConnectorS
 			pos = item->pos();
 			newLine.translate(-pos);
 			item->setLine(newLine);
-			item->m_segmentIdx = i; // regular line segment
+			item->setSegmentIndex(i); // regular line segment
 			start = next;
 		}
 	} catch (...) {
 		// error handling
 	}
-//	for (auto item : m_connectorSegmentItems)
-//		qDebug() << item << " : " << item->m_connector << " : " << item->m_segmentIdx << " : " << item->line();
 }
 
 
@@ -35,9 +35,18 @@
 #define BM_SceneManagerH
 
 #include <QGraphicsScene>
-#include <QMap>
+#include <QMetaType>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+
+#include "BM_Connector.h"
+#include "BM_NetworkChangeSet.h"
+#include "BM_NetworkSnapshot.h"
+#include "BM_UndoStep.h"
 
 class QGraphicsItem;
+class QTimer;
 
 namespace BLOCKMOD {
 
@@ -48,11 +57,20 @@ class Socket;
 class SocketItem;
 class Connector;
 class ConnectorSegmentItem;
+class ConnectorPathItem;
 
 /*! The graphics scene that visualizes the network. */
 class SceneManager : public QGraphicsScene {
 	Q_OBJECT
 public:
+	/*! Determines how connectors are represented in the scene. */
+	enum ConnectorItemMode {
+		/*! One line item for start line, end line and each segment (default). */
+		SegmentItems,
+		/*! One ConnectorPathItem per connector (fewer items in scene and scene index). */
+		PathItems
+	};
+
 	explicit SceneManager(QObject *parent = nullptr);
 
 	/*! D-tor. */
@@ -63,14 +81,167 @@ public:
 	*/
 	void setNetwork(const Network & network);
 
+	/*! Set a new network by moving the network data into the scene manager (no copy is made).
+		This will recreate the entire scene.
+	*/
+	void setNetwork(Network && network);
+
+	/*! Set a new network by moving the network data into the scene manager and create the graphics items
+		incrementally, in chunks that take at most populationTimeBudget() ms per event loop turn.
+		Items of blocks and connectors close to priorityRect are created first. If priorityRect is empty,
+		the area visible in the first view of the scene is used.
+		The first chunk is created right away, so that the scene is interactive immediately.
+		populationFinished() is emitted once all items have been created.
+		\note While populating, blockItemByName() returns nullptr for blocks that do not have an item yet.
+	*/
+	void setNetworkIncremental(Network && network, const QRectF & priorityRect = QRectF());
+
+	/*! Returns true while items are still being created after setNetworkIncremental(). */
+	bool isPopulating() const { return !m_pendingItems.isEmpty(); }
+
+	/*! Creates all items still pending from setNetworkIncremental() right away. */
+	void finishPopulation();
+
+	/*! Sets the time in ms spent on creating items in each event loop turn during incremental population. */
+	void setPopulationTimeBudget(int ms) { m_populationTimeBudget = ms; }
+
+	/*! Returns the time in ms spent on creating items in each event loop turn (default 8 ms). */
+	int populationTimeBudget() const { return m_populationTimeBudget; }
+
+	/*! Enables or disables the virtualized mode.
+		In virtualized mode, only blocks and connectors intersecting the visible area of the attached views
+		(plus a margin of half the visible size in each direction) have graphics items. Block items leaving
+		the visible area are kept in a pool and re-used for blocks that become visible. Selected items are kept.
+		The scene rect is set to the extent of the network, so that all parts can be scrolled to.
+		\note In virtualized mode, blockItemByName() returns nullptr for blocks outside the visible area.
+	*/
+	void setVirtualized(bool virtualized);
+
+	/*! Returns true if virtualized mode is enabled. */
+	bool isVirtualized() const { return m_virtualized; }
+
+	/*! Schedules an update of the graphics items in virtualized mode (does nothing otherwise).
+		Called by ZoomMeshGraphicsView whenever it is scrolled, zoomed or resized. Call this function yourself
+		when using other views with a virtualized scene. Several calls within the same event loop turn
+		result in a single update.
+	*/
+	void updateVisibleArea();
+
+	/*! Updates labels and bounding rects of all socket items.
+		Call this function after changing Globals::LabelFontSize or renaming sockets in the network directly.
+	*/
+	void updateSocketLabels();
+
+	/*! Selects the items painted by the scene, used by views implementing the two-layer mode. */
+	enum LayerFilter {
+		/*! All items are painted (default). */
+		AllLayers,
+		/*! Only items not involved in the current interaction are painted. */
+		StaticLayer,
+		/*! Only items involved in the current interaction are painted. */
+		LiveLayer
+	};
+
+	/*! Enables or disables the two-layer mode.
+		In two-layer mode, dragging blocks starts an interaction: the dragged blocks and their connectors form the
+		live layer, all other items the static layer. Views supporting this mode (ZoomMeshGraphicsView) render the
+		static layer once into cached pixmap tiles and only repaint the live layer while dragging.
+	*/
+	void setLayeredInteraction(bool enabled);
+
+	/*! Returns true if two-layer mode is enabled. */
+	bool isLayeredInteraction() const { return m_layeredInteraction; }
+
+	/*! Returns true while items are dragged in two-layer mode. */
+	bool isInteractionActive() const { return !m_liveBlocks.isEmpty(); }
+
+	/*! Returns true if the item (or its top-level item) belongs to the live layer of the current interaction. */
+	bool isLiveItem(const QGraphicsItem * item) const;
+
+	/*! Enables or disables coalesced drag updates.
+		When enabled, dragging block items with the mouse starts a drag session: block moves are only collected,
+		and the connectors of all moved blocks are adjusted once per frame (see Globals::DragUpdateInterval)
+		and when the mouse is released. Each update emits a single networkGeometryChanged() signal.
+		Block moves not caused by mouse dragging (e.g. setPos() calls) are processed immediately.
+	*/
+	void setCoalescedDragUpdates(bool enabled);
+
+	/*! Returns true if coalesced drag updates are enabled. */
+	bool isCoalescedDragUpdates() const { return m_coalescedDragUpdates; }
+
+	/*! Returns true while block items are dragged in coalesced drag mode. */
+	bool isDragSessionActive() const { return m_dragSessionActive; }
+
+
+	// undo/redo
+
+	/*! Enables or disables the built-in undo stack.
+		When enabled, each operation reported by networkChanged() is stored as an undo step with the inverse
+		deltas of the changed blocks and connectors. Consecutive move steps recorded while the mouse is dragging
+		are merged into one step. Disabling the undo stack clears it.
+		\note setNetwork() and setNetworkIncremental() clear the undo stack.
+	*/
+	void setUndoEnabled(bool enabled);
+
+	/*! Returns true if the undo stack is enabled. */
+	bool isUndoEnabled() const { return m_undoEnabled; }
+
+	/*! Sets the maximum number of undo steps, older steps are discarded. */
+	void setUndoLimit(int limit);
+
+	/*! Returns true if there is a step to undo. */
+	bool canUndo() const { return !m_undoStack.isEmpty(); }
+
+	/*! Returns true if there is a step to redo. */
+	bool canRedo() const { return !m_redoStack.isEmpty(); }
+
+	/*! Reverts the last step. Only the affected blocks, connectors and their items are modified, and a single
+		networkChanged() signal is emitted. Throws an exception when called in batch mode.
+		If the step cannot be applied, the exception is passed on and the step remains on the undo stack.
+	*/
+	void undo();
+
+	/*! Applies the last reverted step again. Throws an exception when called in batch mode. */
+	void redo();
+
+	/*! Removes all undo and redo steps. */
+	void clearUndoStack();
+
+	/*! Sets the layer filter for subsequent paint operations. Views set the filter before rendering and reset it
+		to AllLayers afterwards.
+	*/
+	void setLayerFilter(LayerFilter filter) { m_layerFilter = filter; }
+
+	/*! Returns the current layer filter. */
+	LayerFilter layerFilter() const { return m_layerFilter; }
+
 	/*! Provide read-only access to the network data structure.
 		\note This data structure is internally used and modified by user actions.
 		So, whenever a change signal is emitted, this network contains
-		already the changes. If you need to create UNDO actions based on the previous
-		state of the network, you must keep a separate copy of the network.
+		already the changes. For undo/redo, use the built-in undo stack (see setUndoEnabled())
+		instead of keeping a separate copy of the network.
 	*/
 	const Network & network() const;
 
+	/*! Returns an immutable snapshot of the current network, that can be read from other threads while
+		the network is edited.
+		The first call after setNetwork() copies all blocks and connectors. Afterwards, the scene manager only
+		keeps track of changed blocks and connectors (see networkChanged()), and the next snapshot copies only
+		these and the pages holding them, all others are shared with the previous snapshot
+		(see Network::snapshot(const NetworkSnapshot &, ...)). When blocks or connectors were added or removed,
+		the order lists of the snapshot are rebuilt, which is O(n).
+		Throws an exception when called in batch mode.
+	*/
+	NetworkSnapshot snapshot();
+
+	/*! Selects the graphics items used for connectors.
+		Changing the mode re-creates all connector items of the scene.
+	*/
+	void setConnectorItemMode(ConnectorItemMode mode);
+
+	/*! Returns the current connector item mode. */
+	ConnectorItemMode connectorItemMode() const { return m_connectorItemMode; }
+
 	/*! Generates a pixmap from the current scene rect.
 		Aspect ratio is kept, and the image is fitted into the selected target size.
 	*/
@@ -104,6 +275,11 @@ public:
 	*/
 	void connectorSegmentMoved(ConnectorSegmentItem * currentItem);
 
+	/*! Called from connector items before the segments of the connector are modified, so that the
+		segments can be restored by undo.
+	*/
+	void connectorAboutToMove(const Connector & con);
+
 	/*! Toggles high-lighting of connector segments. */
 	void highlightConnectorSegments(const Connector & con, bool highlighted);
 
@@ -187,6 +363,14 @@ public:
 	*/
 	void removeBlock(unsigned int blockIndex);
 
+	/*! Removes several blocks at once, together with all connections made to these blocks.
+		Only the graphics items of the removed blocks and affected connectors are deleted, which are looked up
+		by block and connector. Removing items and elements from the ordered lists of items, blocks and connectors
+		is still linear in their size (see Network::removeBlocks()).
+		Blocks must be stored in the network's block list, otherwise an exception is thrown.
+	*/
+	void removeBlocks(const QList<const Block*> & blocks);
+
 	/*! Removes connector by giving a pointer to a connector in the managed network.
 		Connector must be stored in the network's connector list.
 	*/
@@ -197,6 +381,54 @@ public:
 	*/
 	void removeConnector(unsigned int connectorIndex);
 
+	/*! Renames a block.
+		Block must be stored in the network's block list, otherwise an exception is thrown.
+	*/
+	void renameBlock(const Block * block, const QString & newName);
+
+
+	// batch editing
+
+	/*! Starts a batch edit (calls may be nested).
+		While in batch mode, addBlock() and addConnector() only add the data to the network. Validation of
+		connectors, adjustConnector() calls, graphics item creation and networkGeometryChanged() signals are deferred
+		until the outermost commitBatch() call, so that large imports are processed with cost linear in
+		the number of added/removed entities.
+	*/
+	void beginBatch();
+
+	/*! Ends a batch edit. When the outermost batch is committed, all deferred work is done.
+		Connectors added in the batch that turn out to be invalid are removed from the network and an
+		exception is thrown afterwards (the scene is consistent in this case).
+	*/
+	void commitBatch();
+
+	/*! Returns true while in batch mode. */
+	bool isInBatch() const { return m_batchDepth > 0; }
+
+	/*! RAII helper for batch edits. Calls beginBatch() in constructor and commitBatch() in destructor.
+		\code
+		{
+			SceneManager::BatchEdit batch(sceneManager);
+			for (...)
+				sceneManager->addBlock(b);
+			batch.commit(); // optional, to receive exceptions about invalid connectors
+		}
+		\endcode
+		Exceptions thrown when committing in the destructor are only reported to std::cerr.
+	*/
+	class BatchEdit {
+	public:
+		explicit BatchEdit(SceneManager * sceneManager);
+		~BatchEdit();
+		/*! Commits the batch, may throw an exception (see SceneManager::commitBatch()). */
+		void commit();
+	private:
+		Q_DISABLE_COPY(BatchEdit)
+		/*! Scene manager, set to nullptr once the batch was committed. */
+		SceneManager * m_sceneManager;
+	};
+
 
 signals:
 	/*! Emitted when a new connection was made and a connector was added.
@@ -213,12 +445,31 @@ signals:
 	/*! Emitted, when a connector was selected. */
 	void newConnectorSelected(const QString & sourceSocketName, const QString & targetSocketName);
 
-	/*! Emitted when a block or connector has been moved. */
-	void networkGeometryChanged();
+	/*! Emitted when blocks or connectors have been moved.
+		\param movedBlocks Blocks that have been moved.
+		\param changedConnectors Connectors whose segments have been changed (by moving the connector or
+			its blocks).
+		In coalesced drag mode, the signal is emitted once per frame for all blocks moved during that frame.
+	*/
+	void networkGeometryChanged(const QSet<BLOCKMOD::BlockHandle> & movedBlocks,
+								const QSet<BLOCKMOD::ConnectorHandle> & changedConnectors);
+
+	/*! Emitted once per operation that modified the network (add/remove/move/rename of blocks and connectors,
+		mouse-created connections, setNetwork()), with records of all changed entities.
+		In batch mode, the signal is emitted in the outermost commitBatch(), in coalesced drag mode once per frame.
+		\note The same rule as for networkGeometryChanged() applies: never call setNetwork() when processing this signal.
+	*/
+	void networkChanged(const BLOCKMOD::NetworkChangeSet & changes);
+
+	/*! Emitted when undo or redo steps have been added or removed. */
+	void undoStackChanged();
 
 	/*! Emitted when the selection was cleared (by click on empty space in view). */
 	void selectionCleared();
 
+	/*! Emitted when all items have been created after setNetworkIncremental(). */
+	void populationFinished();
+
 protected:
 	/*! Listens for right-mouse-button clicks that turn off connection mode. */
 	virtual void mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent) override;
@@ -251,11 +502,123 @@ protected:
 	*/
 	virtual QList<ConnectorSegmentItem *> createConnectorItems(Connector & con);
 
+	/*! Create the graphics item for an entire connector, used in PathItems mode.
+		You can override this method and create your own graphics items, derived from
+		base class ConnectorPathItem.
+	*/
+	virtual ConnectorPathItem * createConnectorPathItem(Connector & con);
+
+	/*! Re-implemented to skip items not matching the current layer filter (see setLayerFilter()).
+		Called when rendering the scene and from views with indirect painting enabled.
+	*/
+	virtual void drawItems(QPainter *painter, int numItems, QGraphicsItem *items[],
+						   const QStyleOptionGraphicsItem options[], QWidget *widget = nullptr) override;
+
 
 private:
+	/*! A block or connector whose items are still to be created during incremental population.
+		Either m_block or m_connector is valid.
+	*/
+	struct PendingItem {
+		/*! Distance from center of priority rect, items are created in order of increasing distance. */
+		double				m_distance;
+		BlockHandle			m_block;
+		ConnectorHandle		m_connector;
+	};
+
+	/*! Moves the network into the scene manager, resolves connectors and removes all items
+		(also pending items of an incremental population).
+	*/
+	void setNetworkData(Network && network);
+
+	/*! Creates items for pending blocks and connectors until timeBudget (in ms) is used up.
+		With a negative budget, all items are created. Emits populationFinished() when done.
+	*/
+	void populateItems(int timeBudget);
+
+	/*! Virtualized mode: creates items for all blocks and connectors in the visible area and moves
+		block items outside the visible area into the pool (connector items are deleted).
+	*/
+	void updateVirtualizedItems();
+
+	/*! Returns the union of the visible areas of all views, enlarged by the virtualization margin. */
+	QRectF visibleRegion() const;
+
+	/*! Virtualized mode: sets the scene rect to the extent of all blocks in the network.
+		Scans all blocks, only needed after removing blocks or setting a new network.
+	*/
+	void updateVirtualSceneRect();
+
+	/*! Virtualized mode: grows the scene rect so that it includes the given block rectangle. */
+	void extendVirtualSceneRect(const QRectF & blockRect);
+
+	/*! Two-layer mode: starts an interaction, the dragged block item, all selected blocks and their
+		connectors form the live layer.
+	*/
+	void startInteraction(const BlockItem * grabber);
+
+	/*! Two-layer mode: ends the current interaction, all items are painted normally again. */
+	void finishInteraction();
+
+	/*! Coalesced drag mode: adjusts the connectors of all blocks moved since the last call once,
+		updates their items and emits networkGeometryChanged().
+	*/
+	void flushDragUpdates();
+
+	/*! Coalesced drag mode: flushes pending updates and ends the drag session. */
+	void finishDragSession();
+
+	/*! Appends a block record to the pending change set (connection helper blocks are ignored). */
+	void recordBlockChange(NetworkChangeSet::ChangeType type, const Block & block,
+						   const QPointF & oldPos = QPointF(), const QString & oldName = QString());
+
+	/*! Appends a connector record to the pending change set (connection helper connectors are ignored). */
+	void recordConnectorChange(NetworkChangeSet::ChangeType type, const Connector & con);
+
+	/*! Emits networkChanged() with the pending change set, unless in batch mode or there are no changes.
+		Also completes the current undo step and pushes it onto the undo stack.
+	*/
+	void emitNetworkChanged();
+
+	/*! Completes the current undo step and pushes it onto the undo stack (or merges it into the previous step). */
+	void pushUndoStep();
+
+	/*! Applies the inverse deltas (undo = true) or the deltas (undo = false) of the given step. */
+	void applyUndoStep(const UndoStep & step, bool undo);
+
+	/*! Moves block to the given position, without adjusting its connectors (undo/redo only). */
+	void moveBlockTo(const BlockHandle & handle, const QPointF & pos);
+
+	/*! Returns the current handle of a block, that may have been removed and re-created by undo/redo. */
+	BlockHandle undoBlockHandle(BlockHandle handle) const;
+
+	/*! Returns the current handle of a connector, that may have been removed and re-created by undo/redo. */
+	ConnectorHandle undoConnectorHandle(ConnectorHandle handle) const;
+
+	/*! Marks a block as changed since the last snapshot. */
+	void blockChangedForSnapshot(const BlockHandle & handle, bool orderChanged);
+
+	/*! Marks a connector as changed since the last snapshot. */
+	void connectorChangedForSnapshot(const ConnectorHandle & handle, bool orderChanged);
+
+	/*! Two-layer mode: tells all views that the static layer within rect (scene coordinates) has changed.
+		A null rect invalidates the entire static layer.
+	*/
+	void staticLayerChanged(const QRectF & rect);
+
+	/*! Returns the socket item showing the given socket, or nullptr if there is none (e.g. block is not
+		shown in virtualized mode). Uses the scene's item index, so it does not iterate over all block items.
+	*/
+	SocketItem * socketItemAt(const SocketHandle & socket) const;
+
+	/*! Connection mode: marks the given inlet socket as hovered and un-hovers the previously hovered socket.
+		Pass an invalid handle to only un-hover the previous socket.
+	*/
+	void setHoveredSocket(const SocketHandle & socket);
+
 	/*! Looks up all segment items belonging to this connector and updates
 		their coordinates.
-		Adds/removes segment items as necessary and updates m_connectorSegmentItems accordingly.
+		Adds/removes segment items as necessary and updates m_connectorItems accordingly.
 
 		\param con Connector to sync with connector items
 		\param currentItem Pointer to currently moved item. May be a nullptr, in which case the
@@ -263,26 +626,158 @@ private:
 	*/
 	void updateConnectorSegmentItems(const Connector & con, ConnectorSegmentItem * currentItem);
 
+	/*! Computes start and end line of a connector in scene coordinates.
+		Throws an exception if sockets of the connector cannot be resolved.
+	*/
+	void connectorLines(const Connector & con, QLineF & startLine, QLineF & endLine) const;
+
+	/*! Returns the item of the block, or nullptr if the block has no item (O(1)). */
+	BlockItem * blockItem(const Block * block) const;
+
+	/*! Creates all segment items of a connector and adds them to the scene. */
+	void addConnectorItems(Connector & con);
+
+	/*! Adds a segment item to the scene and stores it in the connector item index (according to its segment index). */
+	void addConnectorSegmentItem(ConnectorSegmentItem * item);
+
+	/*! Removes the connector referenced by the (valid) handle together with its items. */
+	void removeConnector(const ConnectorHandle & handle);
+
+	/*! Deletes all segment items of a connector and removes the connector from the connector item index. */
+	void deleteConnectorItems(const Connector * con);
+
+	/*! Deletes all connector segment items in the scene. */
+	void clearConnectorItems();
+
+	/*! Clears all data collected during a batch edit. */
+	void clearBatchData();
+
 	/*! The network that we own and manage. */
 	Network							*m_network;
 
 	/*! The block-graphics items that we show on the scene. */
 	QList<BlockItem*>				m_blockItems;
-
-	/*! The connector-graphics items that we show on the scene. */
-	QList<ConnectorSegmentItem*>	m_connectorSegmentItems;
-
-	/*! Map to speed up lookup of connectors connected to a block.
-		This map is initialized in createConnectorItems() and updated, whenever a connection is
-		made/removed.
+	/*! Maps blocks to their items in m_blockItems (blocks without item are not contained). */
+	QHash<const Block*, BlockItem*>	m_blockItemIndex;
+
+	/*! All graphics items of a single connector. */
+	struct ConnectorItems {
+		ConnectorItems() : m_startItem(nullptr), m_endItem(nullptr), m_pathItem(nullptr) {}
+
+		/*! Returns start, end, path and all segment items. */
+		QList<ConnectorSegmentItem*> allItems() const;
+
+		/*! Start line item (segment index -1). */
+		ConnectorSegmentItem			*m_startItem;
+		/*! End line item (segment index -2). */
+		ConnectorSegmentItem			*m_endItem;
+		/*! Segment items, ordered by segment index. */
+		QList<ConnectorSegmentItem*>	m_segmentItems;
+		/*! Path item representing the entire connector (only in PathItems mode). */
+		ConnectorPathItem				*m_pathItem;
+	};
+
+	/*! The connector-graphics items that we show on the scene, indexed by connector, so that
+		all functions working on the items of a single connector are O(segments of that connector).
 	*/
-	QMap<const Block*, QSet<Connector*> >	m_blockConnectorMap;
+	QHash<const Connector*, ConnectorItems>	m_connectorItems;
+
+	/*! Type of items used for connectors. */
+	ConnectorItemMode				m_connectorItemMode;
 
 	/*! If true, the we are currently dragging a connection line. */
 	bool							m_currentlyConnecting;
+	/*! Inlet socket currently marked as hovered in connection mode (invalid if none). */
+	SocketHandle					m_hoveredSocket;
+
+	/*! Nesting level of beginBatch() calls, 0 if not in batch mode. */
+	unsigned int					m_batchDepth;
+	/*! Blocks added during the current batch (items are created in commitBatch()). */
+	QList<BlockHandle>				m_batchBlocks;
+	/*! Connectors added during the current batch (validated and shown in commitBatch()).
+		Connectors removed during the batch are kept in the list, but not in m_batchConnectorSet.
+	*/
+	QList<ConnectorHandle>			m_batchConnectors;
+	/*! Connectors added and not removed again during the current batch, for O(1) membership tests. */
+	QSet<ConnectorHandle>			m_batchConnectorSet;
+	/*! Blocks moved during the current batch (connectors are adjusted in commitBatch()). */
+	QSet<BlockHandle>				m_batchMovedBlocks;
+	/*! If true, networkGeometryChanged() is emitted in commitBatch(). */
+	bool							m_batchGeometryChanged;
+	/*! If true, blocks were removed during the current batch and the virtual scene rect is recomputed in commitBatch(). */
+	bool							m_batchBlocksRemoved;
+
+	/*! Blocks and connectors still to be created during incremental population, sorted by distance. */
+	QVector<PendingItem>			m_pendingItems;
+	/*! Index of next item in m_pendingItems to be created. */
+	int								m_pendingItemPos;
+	/*! Zero-interval timer that creates the next chunk of pending items in each event loop turn. */
+	QTimer							*m_populationTimer;
+	/*! Time budget in ms for creating items in each event loop turn. */
+	int								m_populationTimeBudget;
+
+	/*! If true, only items in the visible area exist. */
+	bool							m_virtualized;
+	/*! Single-shot zero-interval timer that updates the items in virtualized mode. */
+	QTimer							*m_virtualizationTimer;
+	/*! Block items not in the scene, ready to be re-used for other blocks (virtualized mode only). */
+	QList<BlockItem*>				m_blockItemPool;
+
+	/*! If true, dragging blocks starts an interaction with separate static and live layers. */
+	bool							m_layeredInteraction;
+	/*! Items painted in current paint operation. */
+	LayerFilter						m_layerFilter;
+	/*! Blocks whose items belong to the live layer (empty if no interaction is active). */
+	QSet<const Block*>				m_liveBlocks;
+	/*! Connectors whose items belong to the live layer. */
+	QSet<const Connector*>			m_liveConnectors;
+
+	/*! If true, dragging blocks with the mouse starts a drag session with coalesced updates. */
+	bool							m_coalescedDragUpdates;
+	/*! True while block items are dragged in coalesced drag mode. */
+	bool							m_dragSessionActive;
+	/*! Blocks moved since the last flushDragUpdates() call. */
+	QSet<BlockHandle>				m_dragMovedBlocks;
+	/*! Single-shot timer that calls flushDragUpdates() once per frame during a drag session. */
+	QTimer							*m_dragTimer;
+
+	/*! Changes of the current operation, emitted by emitNetworkChanged(). */
+	NetworkChangeSet				m_changes;
+
+	/*! If true, operations are recorded in the undo stack. */
+	bool							m_undoEnabled;
+	/*! True while an undo step is applied (no recording, networkChanged() is emitted once at the end). */
+	bool							m_applyingUndo;
+	/*! Maximum number of undo steps. */
+	int								m_undoLimit;
+	/*! Undo step of the current operation, pushed onto the undo stack by emitNetworkChanged(). */
+	UndoStep						m_undoStep;
+	/*! Undo steps, last step is undone first. */
+	QList<UndoStep>					m_undoStack;
+	/*! Redo steps, last step is redone first. */
+	QList<UndoStep>					m_redoStack;
+	/*! Maps handles of blocks removed by undo/redo to the handles of the re-created blocks. */
+	QHash<BlockHandle, BlockHandle>			m_undoBlockHandles;
+	/*! Maps handles of connectors removed by undo/redo to the handles of the re-created connectors. */
+	QHash<ConnectorHandle, ConnectorHandle>	m_undoConnectorHandles;
+
+	/*! The last snapshot taken, shares all unchanged blocks and connectors with the next snapshot. */
+	NetworkSnapshot					m_snapshot;
+	/*! If false, no snapshot has been taken of the current network yet (changes are not tracked). */
+	bool							m_snapshotValid;
+	/*! Blocks changed, added or removed since the last snapshot. */
+	QSet<BlockHandle>				m_snapshotBlocks;
+	/*! Connectors changed, added or removed since the last snapshot. */
+	QSet<ConnectorHandle>			m_snapshotConnectors;
+	/*! If true, blocks or connectors were added or removed since the last snapshot. */
+	bool							m_snapshotOrderChanged;
 
 };
 
 } // namespace BLOCKMOD
 
+// needed for queued connections to networkGeometryChanged() (types are registered in the SceneManager constructor)
+Q_DECLARE_METATYPE(QSet<BLOCKMOD::BlockHandle>)
+Q_DECLARE_METATYPE(QSet<BLOCKMOD::ConnectorHandle>)
+
 #endif // BM_SceneManagerH
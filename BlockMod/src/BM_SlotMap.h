@@ -0,0 +1,467 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_SlotMapH
+#define BM_SlotMapH
+
+#include <QHash>
+
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace BLOCKMOD {
+
+/*! Handle to an element stored in a SlotMap.
+	The handle stores the slot index and the generation of the slot at the time the element
+	was inserted. When the element is removed, the generation of the slot is increased and
+	all handles to the removed element become stale (SlotMap::get() returns a nullptr).
+	The template argument only serves to distinguish handles of different element types.
+*/
+template <typename T>
+struct SlotHandle {
+	/*! Default C'tor, creates an invalid handle. */
+	SlotHandle() :
+		m_index(InvalidIndex),
+		m_generation(0)
+	{
+	}
+
+	/*! C'tor, initializes all members. */
+	SlotHandle(unsigned int index, unsigned int generation) :
+		m_index(index),
+		m_generation(generation)
+	{
+	}
+
+	/*! Returns true, if the handle was assigned (it may still be stale, use SlotMap::contains() to check). */
+	bool isValid() const { return m_index != InvalidIndex; }
+
+	bool operator==(const SlotHandle & other) const {
+		return m_index == other.m_index && m_generation == other.m_generation;
+	}
+	bool operator!=(const SlotHandle & other) const { return !operator==(other); }
+	bool operator<(const SlotHandle & other) const {
+		return m_index < other.m_index || (m_index == other.m_index && m_generation < other.m_generation);
+	}
+
+	/*! Slot index used in invalid handles. */
+	static const unsigned int InvalidIndex = 0xFFFFFFFF;
+
+	/*! Index of the slot in the slot map. */
+	unsigned int	m_index;
+	/*! Generation of the slot when the handle was created. */
+	unsigned int	m_generation;
+};
+
+template <typename T>
+const unsigned int SlotHandle<T>::InvalidIndex;
+
+/*! Hash function, so that handles can be used in QHash and QSet. */
+template <typename T>
+inline uint qHash(const SlotHandle<T> & handle, uint seed = 0) {
+	return ::qHash(handle.m_index, seed) ^ handle.m_generation;
+}
+
+
+/*! Container with stable element addresses and generational handles.
+
+	Elements are stored in slots, which are allocated in chunks of ChunkSize elements. Chunks are never
+	moved in memory, hence pointers to elements remain valid until the element is removed. Slots of
+	removed elements are kept in a free list and are reused for new elements (with increased generation
+	counter, so that old handles are detected as stale).
+
+	The order of elements (insertion order) is kept in a dense array of slot indexes, so that access by
+	position is O(1) and iteration walks the chunk memory sequentially as long as no slots are reused.
+	Removing an element is O(n) (only the dense index array is compacted).
+
+	The interface resembles the std::list interface (push_back(), back(), erase(), range-based for loops)
+	that was previously used for the network data.
+*/
+template <typename T>
+class SlotMap {
+	/*! Storage slot. */
+	struct Slot {
+		Slot() : m_generation(0), m_alive(false) {}
+		T				m_value;
+		unsigned int	m_generation;
+		bool			m_alive;
+	};
+
+public:
+	typedef SlotHandle<T>	Handle;
+	typedef T				value_type;
+
+	/*! Number of slots per chunk. */
+	enum { ChunkSize = 256 };
+
+	/*! Random access iterator, iterates over the elements in insertion order. */
+	template <typename MapType, typename ValueType>
+	class IteratorBase {
+	public:
+		typedef std::random_access_iterator_tag	iterator_category;
+		typedef T								value_type;
+		typedef std::ptrdiff_t					difference_type;
+		typedef ValueType*						pointer;
+		typedef ValueType&						reference;
+
+		IteratorBase() : m_map(nullptr), m_pos(0) {}
+		IteratorBase(MapType * map, size_t pos) : m_map(map), m_pos(pos) {}
+
+		reference operator*() const { return m_map->slotAt(m_pos).m_value; }
+		pointer operator->() const { return &m_map->slotAt(m_pos).m_value; }
+		reference operator[](difference_type n) const { return m_map->slotAt(m_pos + n).m_value; }
+
+		IteratorBase & operator++() { ++m_pos; return *this; }
+		IteratorBase operator++(int) { IteratorBase tmp(*this); ++m_pos; return tmp; }
+		IteratorBase & operator--() { --m_pos; return *this; }
+		IteratorBase operator--(int) { IteratorBase tmp(*this); --m_pos; return tmp; }
+		IteratorBase & operator+=(difference_type n) { m_pos += n; return *this; }
+		IteratorBase & operator-=(difference_type n) { m_pos -= n; return *this; }
+		IteratorBase operator+(difference_type n) const { return IteratorBase(m_map, m_pos + n); }
+		IteratorBase operator-(difference_type n) const { return IteratorBase(m_map, m_pos - n); }
+		difference_type operator-(const IteratorBase & other) const {
+			return static_cast<difference_type>(m_pos) - static_cast<difference_type>(other.m_pos);
+		}
+
+		bool operator==(const IteratorBase & other) const { return m_pos == other.m_pos; }
+		bool operator!=(const IteratorBase & other) const { return m_pos != other.m_pos; }
+		bool operator<(const IteratorBase & other) const { return m_pos < other.m_pos; }
+
+		/*! Position of the iterator in the slot map (same as index for operator[]). */
+		size_t pos() const { return m_pos; }
+
+	private:
+		MapType		*m_map;
+		size_t		m_pos;
+	};
+
+	typedef IteratorBase<SlotMap, T>				iterator;
+	typedef IteratorBase<const SlotMap, const T>	const_iterator;
+
+	/*! Default C'tor. */
+	SlotMap() : m_slotCount(0), m_eraseCount(0), m_generationBase(0) {}
+
+	/*! Copy constructor, copies all slots so that handles of the original are valid in the copy. */
+	SlotMap(const SlotMap & other) :
+		m_slotCount(other.m_slotCount),
+		m_freeSlots(other.m_freeSlots),
+		m_order(other.m_order),
+		m_eraseCount(other.m_eraseCount),
+		m_generationBase(other.m_generationBase)
+	{
+		m_chunks.reserve(other.m_chunks.size());
+		for (const std::unique_ptr<Slot[]> & otherChunk : other.m_chunks) {
+			m_chunks.push_back(std::unique_ptr<Slot[]>(new Slot[ChunkSize]));
+			std::copy(otherChunk.get(), otherChunk.get() + ChunkSize, m_chunks.back().get());
+			addChunkAddress(m_chunks.size()-1);
+		}
+	}
+
+	/*! Move constructor. */
+	SlotMap(SlotMap && other) :
+		m_chunks(std::move(other.m_chunks)),
+		m_chunkAddresses(std::move(other.m_chunkAddresses)),
+		m_slotCount(other.m_slotCount),
+		m_freeSlots(std::move(other.m_freeSlots)),
+		m_order(std::move(other.m_order)),
+		m_eraseCount(other.m_eraseCount),
+		m_generationBase(other.m_generationBase)
+	{
+		other.m_slotCount = 0;
+	}
+
+	/*! Assignment operator (handles copy and move assignment). */
+	SlotMap & operator=(SlotMap other) {
+		swap(other);
+		return *this;
+	}
+
+	/*! Efficient swap function, element addresses and handles are exchanged as well. */
+	void swap(SlotMap & other) {
+		m_chunks.swap(other.m_chunks);
+		m_chunkAddresses.swap(other.m_chunkAddresses);
+		std::swap(m_slotCount, other.m_slotCount);
+		m_freeSlots.swap(other.m_freeSlots);
+		m_order.swap(other.m_order);
+		std::swap(m_eraseCount, other.m_eraseCount);
+		std::swap(m_generationBase, other.m_generationBase);
+	}
+
+	/*! Number of elements in the slot map. */
+	size_t size() const { return m_order.size(); }
+
+	/*! Returns true if slot map is empty. */
+	bool empty() const { return m_order.empty(); }
+
+	/*! Removes all elements and releases memory.
+		New elements get generations above all previously used generations, so that handles to removed
+		elements are still detected as stale.
+	*/
+	void clear() {
+		for (unsigned int i=0; i<m_slotCount; ++i)
+			m_generationBase = std::max(m_generationBase, slot(i).m_generation + 1);
+		m_eraseCount += m_order.size();
+		m_chunks.clear();
+		m_chunkAddresses.clear();
+		m_slotCount = 0;
+		m_freeSlots.clear();
+		m_order.clear();
+	}
+
+	/*! Total number of elements erased from this slot map (also counts elements removed by clear()).
+		Can be used by index data structures to detect that elements have been removed.
+	*/
+	size_t eraseCount() const { return m_eraseCount; }
+
+	/*! Reserves memory for the dense index array. */
+	void reserve(size_t n) { m_order.reserve(n); }
+
+	/*! Appends a copy of the value and returns the handle of the new element. */
+	Handle push_back(const T & value) {
+		unsigned int idx = allocateSlot();
+		Slot & s = slot(idx);
+		s.m_value = value;
+		s.m_alive = true;
+		m_order.push_back(idx);
+		return Handle(idx, s.m_generation);
+	}
+
+	/*! Appends the value by moving it into the slot map and returns the handle of the new element. */
+	Handle push_back(T && value) {
+		unsigned int idx = allocateSlot();
+		Slot & s = slot(idx);
+		s.m_value = std::move(value);
+		s.m_alive = true;
+		m_order.push_back(idx);
+		return Handle(idx, s.m_generation);
+	}
+
+	/*! Appends a default-constructed element and returns the handle of the new element.
+		Slots always hold default-constructed values until used, so the element is created in place
+		without any copy. Use back() to access the new element.
+	*/
+	Handle emplace_back() {
+		unsigned int idx = allocateSlot();
+		Slot & s = slot(idx);
+		s.m_alive = true;
+		m_order.push_back(idx);
+		return Handle(idx, s.m_generation);
+	}
+
+	/*! Removes the last element. */
+	void pop_back() {
+		releaseSlot(m_order.back());
+		m_order.pop_back();
+	}
+
+	/*! Removes the element at the iterator position.
+		Returns iterator to the element following the removed element.
+	*/
+	iterator erase(iterator it) {
+		size_t pos = it.pos();
+		releaseSlot(m_order[pos]);
+		m_order.erase(m_order.begin() + static_cast<std::ptrdiff_t>(pos));
+		return iterator(this, pos);
+	}
+
+	/*! Removes the element referenced by the handle. Stale handles are ignored.
+		The element's slot is released in O(1), but the position list is searched and shifted to keep the
+		order of the remaining elements, which is linear in the number of elements (a fast scan/move of indexes).
+	*/
+	void erase(const Handle & handle) {
+		if (!contains(handle))
+			return;
+		m_order.erase(std::find(m_order.begin(), m_order.end(), handle.m_index));
+		releaseSlot(handle.m_index);
+	}
+
+	/*! Removes all elements for which the predicate returns true (single pass over all elements).
+		Returns number of removed elements.
+	*/
+	template <typename Predicate>
+	size_t removeIf(Predicate pred) {
+		size_t j = 0;
+		for (size_t i=0; i<m_order.size(); ++i) {
+			unsigned int idx = m_order[i];
+			if (pred(slot(idx).m_value))
+				releaseSlot(idx);
+			else
+				m_order[j++] = idx;
+		}
+		size_t removed = m_order.size() - j;
+		m_order.resize(j);
+		return removed;
+	}
+
+	/*! Access to element at position pos (O(1)). */
+	T & operator[](size_t pos) { return slotAt(pos).m_value; }
+	const T & operator[](size_t pos) const { return slotAt(pos).m_value; }
+
+	T & front() { return slotAt(0).m_value; }
+	const T & front() const { return slotAt(0).m_value; }
+	T & back() { return slotAt(m_order.size()-1).m_value; }
+	const T & back() const { return slotAt(m_order.size()-1).m_value; }
+
+	/*! Returns handle of element at position pos. */
+	Handle handle(size_t pos) const {
+		unsigned int idx = m_order[pos];
+		return Handle(idx, slot(idx).m_generation);
+	}
+
+	/*! Returns handle of element with given address, or an invalid handle if element is not stored in this map.
+		Complexity is O(log(number of chunks)), chunks are looked up in the address-sorted chunk table.
+	*/
+	Handle handleOf(const T * element) const {
+		std::uintptr_t p = reinterpret_cast<std::uintptr_t>(element);
+		// first chunk that starts after the element
+		std::vector<ChunkAddress>::const_iterator it = std::upper_bound(m_chunkAddresses.begin(), m_chunkAddresses.end(),
+			p, [](std::uintptr_t addr, const ChunkAddress & c) { return addr < c.first; });
+		if (it == m_chunkAddresses.begin())
+			return Handle();
+		--it;
+		std::uintptr_t first = it->first;
+		if (p >= first + ChunkSize*sizeof(Slot))
+			return Handle();
+		std::uintptr_t offset = p - first;
+		if (offset % sizeof(Slot) != 0)
+			return Handle();
+		unsigned int idx = static_cast<unsigned int>(it->second*ChunkSize + offset/sizeof(Slot));
+		if (idx >= m_slotCount)
+			return Handle();
+		const Slot & s = slot(idx);
+		if (!s.m_alive)
+			return Handle();
+		return Handle(idx, s.m_generation);
+	}
+
+	/*! Returns true, if the handle references an existing element. */
+	bool contains(const Handle & handle) const {
+		if (handle.m_index >= m_slotCount)
+			return false;
+		const Slot & s = slot(handle.m_index);
+		return s.m_alive && s.m_generation == handle.m_generation;
+	}
+
+	/*! Returns pointer to element referenced by handle, or nullptr if the handle is stale or invalid (O(1)). */
+	T * get(const Handle & handle) {
+		if (!contains(handle))
+			return nullptr;
+		return &slot(handle.m_index).m_value;
+	}
+	const T * get(const Handle & handle) const {
+		if (!contains(handle))
+			return nullptr;
+		return &slot(handle.m_index).m_value;
+	}
+
+	/*! Returns position of element referenced by handle, or size() if the handle is stale (O(n)). */
+	size_t indexOf(const Handle & handle) const {
+		if (!contains(handle))
+			return m_order.size();
+		return static_cast<size_t>(std::find(m_order.begin(), m_order.end(), handle.m_index) - m_order.begin());
+	}
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, m_order.size()); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, m_order.size()); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+private:
+	Slot & slot(unsigned int idx) { return m_chunks[idx / ChunkSize][idx % ChunkSize]; }
+	const Slot & slot(unsigned int idx) const { return m_chunks[idx / ChunkSize][idx % ChunkSize]; }
+	Slot & slotAt(size_t pos) { return slot(m_order[pos]); }
+	const Slot & slotAt(size_t pos) const { return slot(m_order[pos]); }
+
+	/*! Returns index of a free slot, either from the free list or a newly allocated one. */
+	unsigned int allocateSlot() {
+		if (!m_freeSlots.empty()) {
+			unsigned int idx = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			return idx;
+		}
+		if (m_slotCount == m_chunks.size()*ChunkSize) {
+			m_chunks.push_back(std::unique_ptr<Slot[]>(new Slot[ChunkSize]));
+			addChunkAddress(m_chunks.size()-1);
+		}
+		// generations of new slots continue after those used before clear()
+		slot(m_slotCount).m_generation = m_generationBase;
+		return m_slotCount++;
+	}
+
+	/*! Inserts the start address of chunk c into the address-sorted chunk table. */
+	void addChunkAddress(size_t c) {
+		ChunkAddress a(reinterpret_cast<std::uintptr_t>(&m_chunks[c][0].m_value), static_cast<unsigned int>(c));
+		m_chunkAddresses.insert(std::upper_bound(m_chunkAddresses.begin(), m_chunkAddresses.end(), a), a);
+	}
+
+	/*! Resets slot, increases generation and puts slot into free list. */
+	void releaseSlot(unsigned int idx) {
+		Slot & s = slot(idx);
+		s.m_value = T(); // release memory held by element
+		s.m_alive = false;
+		++s.m_generation;
+		m_freeSlots.push_back(idx);
+		++m_eraseCount;
+	}
+
+	/*! Start address and index of a chunk. */
+	typedef std::pair<std::uintptr_t, unsigned int> ChunkAddress;
+
+	/*! Chunks of slots, never moved in memory. */
+	std::vector< std::unique_ptr<Slot[]> >	m_chunks;
+	/*! Start addresses of all chunks, sorted by address (used by handleOf()). */
+	std::vector<ChunkAddress>				m_chunkAddresses;
+	/*! Number of slots in use (alive or in free list). */
+	unsigned int							m_slotCount;
+	/*! Indexes of released slots. */
+	std::vector<unsigned int>				m_freeSlots;
+	/*! Slot indexes of all elements in insertion order. */
+	std::vector<unsigned int>				m_order;
+	/*! Number of erased elements. */
+	size_t									m_eraseCount;
+	/*! Generation of newly allocated slots, increased by clear(). */
+	unsigned int							m_generationBase;
+
+	template <typename MapType, typename ValueType>
+	friend class IteratorBase;
+};
+
+} // namespace BLOCKMOD
+
+#endif // BM_SlotMapH
@@ -40,6 +40,8 @@
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
+#include "BM_SlotMap.h"
+
 namespace BLOCKMOD {
 
 /*! Stores properties of a Socket.
@@ -123,6 +125,53 @@ public:
 	bool			m_inlet;
 };
 
+
+class Block;
+
+/*! Handle to a block in the network (see Network::m_blocks). */
+typedef SlotHandle<Block> BlockHandle;
+
+/*! Resolved reference to a socket within a network.
+	Holds the handle of the block and the index of the socket in the block's
+	socket list. Socket handles are created by Network::resolveConnector() from flat names in format
+	<block-name>.<socket-name>.
+*/
+struct SocketHandle {
+	/*! Default C'tor, creates an invalid handle. */
+	SocketHandle() :
+		m_socketIdx(-1)
+	{
+	}
+
+	/*! C'tor, initializes all members. */
+	SocketHandle(const BlockHandle & block, int socketIdx) :
+		m_block(block),
+		m_socketIdx(socketIdx)
+	{
+	}
+
+	/*! Returns true, if the handle references a socket. */
+	bool isValid() const { return m_block.isValid() && m_socketIdx != -1; }
+
+	bool operator==(const SocketHandle & other) const {
+		return m_block == other.m_block && m_socketIdx == other.m_socketIdx;
+	}
+	bool operator!=(const SocketHandle & other) const { return !operator==(other); }
+	bool operator<(const SocketHandle & other) const {
+		return m_block < other.m_block || (m_block == other.m_block && m_socketIdx < other.m_socketIdx);
+	}
+
+	/*! Handle of the block that holds the socket. */
+	BlockHandle		m_block;
+	/*! Index of the socket in Block::m_sockets. */
+	int				m_socketIdx;
+};
+
+/*! Hash function, so that socket handles can be used in QHash and QSet. */
+inline uint qHash(const SocketHandle & handle, uint seed = 0) {
+	return qHash(handle.m_block, seed) ^ static_cast<uint>(handle.m_socketIdx);
+}
+
 } // namespace BLOCKMOD
 
 
@@ -50,10 +50,24 @@
 
 namespace BLOCKMOD {
 
+/*! Returns the font used for socket labels, re-created only when Globals::LabelFontSize changes. */
+static const QFont & labelFont() {
+	static QFont font;
+	static double fontSize = -1;
+	if (fontSize != Globals::LabelFontSize) {
+		font = QFont();
+		font.setPointSizeF(Globals::LabelFontSize);
+		fontSize = Globals::LabelFontSize;
+	}
+	return font;
+}
+
+
 SocketItem::SocketItem(BlockItem * parent, Socket * socket) :
 	QGraphicsItem (parent),
 	m_block(parent->block()),
 	m_socket(socket),
+	m_labelFontSize(-1),
 	m_hovered(false)
 {
 	updateSocketItem();
@@ -62,7 +76,19 @@ SocketItem::SocketItem(BlockItem * parent, Socket * socket) :
 }
 
 
+void SocketItem::setSocket(Socket * socket) {
+	BlockItem * parent = static_cast<BlockItem *>(parentItem());
+	m_block = parent->block();
+	m_socket = socket;
+	m_hovered = false;
+	updateSocketItem();
+	update();
+}
+
+
 void SocketItem::updateSocketItem() {
+	prepareGeometryChange();
+	updateLabel(); // socket name may have changed as well
 	if (m_socket->m_inlet) {
 		switch (m_socket->direction()) {
 			case Socket::Left		: m_symbolRect = QRectF(-4, m_socket->m_pos.y()-4, 8, 8); break;
@@ -83,12 +109,10 @@ void SocketItem::updateSocketItem() {
 
 
 QRectF SocketItem::boundingRect() const {
-	QRectF r = m_symbolRect;
-	// add space for text
-	QFont f;
-	f.setPointSizeF(Globals::LabelFontSize);
-	QFontMetricsF metrics(f);
-	QRectF textBoundingRect = metrics.boundingRect(m_socket->m_name);
+	// hovered symbol is drawn 1 pixel larger than the symbol rect, plus outline
+	QRectF r = m_symbolRect.adjusted(-2, -2, 2, 2);
+	// add space for text (cached label size)
+	QRectF textBoundingRect(QPointF(0,0), m_labelSize);
 	textBoundingRect.setWidth(textBoundingRect.width()+6); // add some space to avoid clipping of italic fonts to the right
 
 	switch (m_socket->direction()) {
@@ -130,6 +154,7 @@ void SocketItem::hoverEnterEvent (QGraphicsSceneHoverEvent *event) {
 			if (QApplication::overrideCursor() == nullptr)
 				QApplication::setOverrideCursor(Qt::CrossCursor);
 			m_hovered = true;
+			update();
 		}
 	}
 	QGraphicsItem::hoverEnterEvent(event);
@@ -137,20 +162,39 @@ void SocketItem::hoverEnterEvent (QGraphicsSceneHoverEvent *event) {
 
 
 void SocketItem::hoverLeaveEvent (QGraphicsSceneHoverEvent *event) {
-	if (m_hovered)
+	if (m_hovered) {
 		QApplication::restoreOverrideCursor();
+		update();
+	}
 	m_hovered = false;
 	QGraphicsItem::hoverLeaveEvent(event);
 }
 
 
-void SocketItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*option*/, QWidget * /*widget*/ ) {
+void SocketItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * option, QWidget * /*widget*/ ) {
 	// special handling for invisible blocks
 	BlockItem * bi = dynamic_cast<BlockItem*>(parentItem());
 	if (bi->block()->m_name == Globals::InvisibleLabel)
 		return; // nothing to be drawn
+	// level of detail depends on zoom level
+	const double lod = option->levelOfDetailFromTransform(painter->worldTransform());
+	if (lod < Globals::SocketHiddenLevelOfDetail)
+		return; // socket would be smaller than a pixel
+	if (lod < Globals::SocketPointLevelOfDetail) {
+		// draw a single pixel (pen width 0 is cosmetic)
+		painter->save();
+		if (m_hovered)
+			painter->setPen(QPen(QColor(192,0,0), 0));
+		else if (m_socket->m_inlet)
+			painter->setPen(QPen(Qt::black, 0));
+		else
+			painter->setPen(QPen(QColor(0,0,196), 0));
+		painter->drawPoint(m_symbolRect.center());
+		painter->restore();
+		return;
+	}
 	painter->save();
-	painter->setRenderHint(QPainter::Antialiasing, true);
+	painter->setRenderHint(QPainter::Antialiasing, lod >= Globals::DetailLevelOfDetail);
 	// Socket items are children of the blocks.
 	// Coordinates are hence defined with respect to the parent item's coordinate system.
 	// 0,0 is the top-left corner of the parent block.
@@ -249,43 +293,38 @@ void SocketItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*opt
 		painter->drawPath(p);
 	}
 
+	// labels are not readable when zoomed out
+	if (lod < Globals::LabelLevelOfDetail) {
+		painter->restore();
+		return;
+	}
 
-	// now draw the label on the socket
-	QFont f(painter->font());
-	f.setPointSizeF(Globals::LabelFontSize);
-	QFontMetricsF metrics(f);
-	painter->setFont(f);
-	QRectF textBoundingRect = metrics.boundingRect(m_socket->m_name);
-	textBoundingRect.setWidth(textBoundingRect.width()+6); // add some space to avoid clipping of italic fonts to the right
-
+	// now draw the label on the socket, the static text is laid out only once
+	painter->setFont(labelFont());
+	double w = m_labelSize.width();
+	double h = m_labelSize.height();
 	switch (m_socket->direction()) {
 		case Socket::Left		:
-			// left side
-			textBoundingRect.moveTo(r.left()-textBoundingRect.width(), r.top()-textBoundingRect.height()+3);
-			painter->drawText(textBoundingRect, Qt::AlignRight | Qt::AlignTop, m_socket->m_name);
+			// left side, right-aligned
+			painter->drawStaticText(QPointF(r.left()-w, r.top()-h+3), m_label);
 		break;
 		case Socket::Right		:
 			// right side
-			textBoundingRect.moveTo(r.right(), r.top()-textBoundingRect.height()+3);
-			painter->drawText(textBoundingRect, Qt::AlignLeft | Qt::AlignTop, m_socket->m_name);
+			painter->drawStaticText(QPointF(r.right(), r.top()-h+3), m_label);
 		break;
 		case Socket::Top		:
 			// top side
 			painter->translate(r.left(), r.top());
 			painter->rotate(-90);
-			textBoundingRect.moveTo(0, -textBoundingRect.height());
-			painter->drawText(textBoundingRect, Qt::AlignLeft | Qt::AlignTop, m_socket->m_name);
+			painter->drawStaticText(QPointF(0, -h), m_label);
 		break;
 		case Socket::Bottom		:
-			// bottom side
+			// bottom side, right-aligned
 			painter->translate(r.left(), r.bottom());
 			painter->rotate(-90);
-			textBoundingRect.moveTo(-textBoundingRect.width(), -textBoundingRect.height());
-			painter->drawText(textBoundingRect, Qt::AlignRight | Qt::AlignTop, m_socket->m_name);
+			painter->drawStaticText(QPointF(-w, -h), m_label);
 		break;
 	}
-	//	painter->setBrush(Qt::NoBrush);
-	//	painter->drawRect(textBoundingRect);
 
 	painter->restore();
 }
@@ -309,5 +348,19 @@ void SocketItem::mousePressEvent(QGraphicsSceneMouseEvent *event) {
 
 
 
+// *** private functions ***
+
+void SocketItem::updateLabel() {
+	if (m_labelFontSize == Globals::LabelFontSize && m_label.text() == m_socket->m_name)
+		return;
+	const QFont & f = labelFont();
+	m_label.setTextFormat(Qt::PlainText);
+	m_label.setText(m_socket->m_name);
+	m_label.prepare(QTransform(), f);
+	m_labelSize = QFontMetricsF(f).boundingRect(m_socket->m_name).size();
+	m_labelFontSize = Globals::LabelFontSize;
+}
+
+
 } // namespace BLOCKMOD
 
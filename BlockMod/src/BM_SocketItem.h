@@ -35,6 +35,7 @@
 #define BM_SocketItemH
 
 #include <QGraphicsItem>
+#include <QStaticText>
 
 namespace BLOCKMOD {
 
@@ -50,9 +51,14 @@ public:
 	*/
 	explicit SocketItem(BlockItem * parent, Socket * socket);
 
-	/*! Call this function whenever the socket's geometry in the associated socket object has changed. */
+	/*! Call this function whenever the socket's geometry or name in the associated socket object has changed,
+		or Globals::LabelFontSize was modified (see SceneManager::updateSocketLabels()).
+	*/
 	void updateSocketItem();
 
+	/*! Associates the item with another socket of the parent's block, used when block items are recycled. */
+	void setSocket(Socket * socket);
+
 	QRectF boundingRect() const override;
 
 	/*! Returns pointer to socket. */
@@ -75,9 +81,19 @@ private:
 	/*! Pointer to the socket data structure. */
 	Socket	*m_socket;
 
+	/*! Updates the cached label text and size if socket name or Globals::LabelFontSize have changed. */
+	void updateLabel();
+
 	/*! The bounding rectangle of the symbol (updated whenever content of the socket changes). */
 	QRectF	m_symbolRect;
 
+	/*! The label text, laid out once and re-used in every paint() call. */
+	QStaticText	m_label;
+	/*! Size of the label text (unrotated), used for bounding rect and label placement. */
+	QSizeF	m_labelSize;
+	/*! Font size that m_label and m_labelSize were computed with. */
+	double	m_labelFontSize;
+
 	/*! Set to true, when mouse hovers over item.
 		Causes different pointing operation to be used.
 	*/
@@ -0,0 +1,188 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_SpatialGridH
+#define BM_SpatialGridH
+
+#include <QHash>
+#include <QVector>
+#include <QRect>
+#include <QRectF>
+
+#include <cmath>
+#include <algorithm>
+
+namespace BLOCKMOD {
+
+/*! A uniform grid that indexes objects (identified by handles) by their bounding rects.
+	Each object is stored in all cells its bounding rect overlaps. Only cells that contain objects
+	are allocated, so the grid is unbounded.
+
+	Queries return candidates whose cells overlap the query rect, each candidate only once. Callers
+	have to test the exact geometry of the candidates themselves.
+*/
+template <typename Handle>
+class SpatialGrid {
+public:
+	/*! C'tor, cellSize is the edge length of a grid cell in scene coordinates. */
+	explicit SpatialGrid(double cellSize) : m_cellSize(cellSize) {}
+
+	/*! Adds an object with given bounding rect to the grid. */
+	void insert(const Handle & handle, const QRectF & rect) {
+		QRect range = cellRange(rect);
+		m_ranges[handle] = range;
+		for (int x=range.left(); x<=range.right(); ++x)
+			for (int y=range.top(); y<=range.bottom(); ++y)
+				m_cells[cellKey(x, y)].append(Entry(handle, range));
+	}
+
+	/*! Removes an object from the grid, does nothing if object is not in the grid. */
+	void remove(const Handle & handle) {
+		typename QHash<Handle, QRect>::iterator it = m_ranges.find(handle);
+		if (it == m_ranges.end())
+			return;
+		QRect range = it.value();
+		m_ranges.erase(it);
+		for (int x=range.left(); x<=range.right(); ++x) {
+			for (int y=range.top(); y<=range.bottom(); ++y) {
+				typename QHash<quint64, QVector<Entry> >::iterator cit = m_cells.find(cellKey(x, y));
+				if (cit == m_cells.end())
+					continue;
+				QVector<Entry> & entries = cit.value();
+				for (int i=0; i<entries.count(); ++i) {
+					if (entries[i].m_handle == handle) {
+						// order within a cell does not matter
+						entries[i] = entries.back();
+						entries.removeLast();
+						break;
+					}
+				}
+				if (entries.isEmpty())
+					m_cells.erase(cit);
+			}
+		}
+	}
+
+	/*! Updates the bounding rect of an object. Only touches the cells if the cell range changed. */
+	void update(const Handle & handle, const QRectF & rect) {
+		typename QHash<Handle, QRect>::const_iterator it = m_ranges.constFind(handle);
+		if (it != m_ranges.constEnd() && it.value() == cellRange(rect))
+			return;
+		remove(handle);
+		insert(handle, rect);
+	}
+
+	/*! Returns true, if the object is stored in the grid. */
+	bool contains(const Handle & handle) const { return m_ranges.contains(handle); }
+
+	/*! Appends all objects in cells overlapping rect to candidates (each object only once). */
+	void query(const QRectF & rect, QVector<Handle> & candidates) const {
+		QRect range = cellRange(rect);
+		// for very large query rects, visiting the non-empty cells is cheaper than visiting all cells in range
+		if ((qint64)range.width()*range.height() > m_cells.count()) {
+			for (typename QHash<quint64, QVector<Entry> >::const_iterator cit = m_cells.constBegin();
+				 cit != m_cells.constEnd(); ++cit)
+			{
+				int x = (int)quint32(cit.key() >> 32);
+				int y = (int)quint32(cit.key());
+				if (range.contains(x, y))
+					appendCandidates(x, y, cit.value(), range, candidates);
+			}
+			return;
+		}
+		for (int x=range.left(); x<=range.right(); ++x) {
+			for (int y=range.top(); y<=range.bottom(); ++y) {
+				typename QHash<quint64, QVector<Entry> >::const_iterator cit = m_cells.constFind(cellKey(x, y));
+				if (cit != m_cells.constEnd())
+					appendCandidates(x, y, cit.value(), range, candidates);
+			}
+		}
+	}
+
+	/*! Removes all objects. */
+	void clear() {
+		m_cells.clear();
+		m_ranges.clear();
+	}
+
+	/*! Efficient swap function. */
+	void swap(SpatialGrid & other) {
+		std::swap(m_cellSize, other.m_cellSize);
+		m_cells.swap(other.m_cells);
+		m_ranges.swap(other.m_ranges);
+	}
+
+private:
+	/*! An object in a cell, with the cell range of the object (needed to report objects only once). */
+	struct Entry {
+		Entry() {}
+		Entry(const Handle & handle, const QRect & range) : m_handle(handle), m_range(range) {}
+		Handle	m_handle;
+		QRect	m_range;
+	};
+
+	/*! Appends the objects in cell x,y to candidates.
+		Objects spanning several cells are only reported from the first cell in both the object's and the query's cell range.
+	*/
+	static void appendCandidates(int x, int y, const QVector<Entry> & entries, const QRect & range, QVector<Handle> & candidates) {
+		for (const Entry & e : entries) {
+			if (x == std::max(e.m_range.left(), range.left()) && y == std::max(e.m_range.top(), range.top()))
+				candidates.append(e.m_handle);
+		}
+	}
+
+	/*! Returns the range of cells (inclusive) overlapped by rect. */
+	QRect cellRange(const QRectF & rect) const {
+		int left = (int)std::floor(rect.left()/m_cellSize);
+		int right = (int)std::floor(rect.right()/m_cellSize);
+		int top = (int)std::floor(rect.top()/m_cellSize);
+		int bottom = (int)std::floor(rect.bottom()/m_cellSize);
+		return QRect(QPoint(left, top), QPoint(right, bottom));
+	}
+
+	/*! Combines cell coordinates into a hash key. */
+	static quint64 cellKey(int x, int y) {
+		return (quint64(quint32(x)) << 32) | quint64(quint32(y));
+	}
+
+	/*! Edge length of a cell. */
+	double									m_cellSize;
+	/*! Objects in each non-empty cell. */
+	QHash<quint64, QVector<Entry> >			m_cells;
+	/*! Cell range of each object. */
+	QHash<Handle, QRect>					m_ranges;
+};
+
+} // namespace BLOCKMOD
+
+#endif // BM_SpatialGridH
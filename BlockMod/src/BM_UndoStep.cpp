@@ -0,0 +1,152 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BM_UndoStep.h"
+
+#include "BM_Network.h"
+
+namespace BLOCKMOD {
+
+bool UndoStep::isMoveOnly() const {
+	for (const BlockDelta & d : m_blockDeltas)
+		if (d.m_type != NetworkChangeSet::Moved)
+			return false;
+	for (const ConnectorDelta & d : m_connectorDeltas)
+		if (d.m_type != NetworkChangeSet::Moved)
+			return false;
+	return true;
+}
+
+
+void UndoStep::captureConnector(const ConnectorHandle & handle, const Connector & con) {
+	if (!m_capturedSegments.contains(handle))
+		m_capturedSegments[handle] = con.m_segments;
+}
+
+
+void UndoStep::recordBlock(NetworkChangeSet::ChangeType type, const BlockHandle & handle, const Block & block,
+						   const QPointF & oldPos, const QString & oldName)
+{
+	if (type == NetworkChangeSet::Moved && m_movedBlocks.contains(handle))
+		return; // first delta holds the original position
+	BlockDelta d;
+	d.m_type = type;
+	d.m_block = handle;
+	if (type == NetworkChangeSet::Added || type == NetworkChangeSet::Removed)
+		d.m_data = block;
+	d.m_oldPos = oldPos;
+	d.m_newPos = block.m_pos;
+	d.m_oldName = oldName;
+	d.m_newName = block.m_name;
+	if (type == NetworkChangeSet::Moved)
+		m_movedBlocks[handle] = m_blockDeltas.count();
+	m_blockDeltas.append(d);
+}
+
+
+void UndoStep::recordConnector(NetworkChangeSet::ChangeType type, const ConnectorHandle & handle, const Connector & con,
+							   const QString & sourceSocket, const QString & targetSocket)
+{
+	if (type == NetworkChangeSet::Moved && m_movedConnectors.contains(handle))
+		return;
+	ConnectorDelta d;
+	d.m_type = type;
+	d.m_connector = handle;
+	d.m_hasSegments = false;
+	if (type == NetworkChangeSet::Added || type == NetworkChangeSet::Removed) {
+		// store connector with flat names, the socket handles are not valid once the blocks are re-created
+		d.m_data = con;
+		d.m_data.m_sourceSocket = sourceSocket;
+		d.m_data.m_targetSocket = targetSocket;
+		d.m_data.m_source = SocketHandle();
+		d.m_data.m_target = SocketHandle();
+	}
+	else if (type == NetworkChangeSet::Moved) {
+		QHash<ConnectorHandle, QList<Connector::Segment> >::const_iterator it = m_capturedSegments.constFind(handle);
+		if (it != m_capturedSegments.constEnd()) {
+			d.m_hasSegments = true;
+			d.m_oldSegments = it.value();
+		}
+		m_movedConnectors[handle] = m_connectorDeltas.count();
+	}
+	m_connectorDeltas.append(d);
+}
+
+
+void UndoStep::finish(const Network & network) {
+	for (BlockDelta & d : m_blockDeltas) {
+		if (d.m_type != NetworkChangeSet::Moved)
+			continue;
+		const Block * b = network.m_blocks.get(d.m_block);
+		if (b != nullptr)
+			d.m_newPos = b->m_pos;
+	}
+	for (ConnectorDelta & d : m_connectorDeltas) {
+		if (d.m_type != NetworkChangeSet::Moved)
+			continue;
+		const Connector * con = network.m_connectors.get(d.m_connector);
+		if (con != nullptr)
+			d.m_newSegments = con->m_segments;
+		else
+			d.m_hasSegments = false;
+	}
+	m_capturedSegments.clear();
+}
+
+
+void UndoStep::merge(const UndoStep & other) {
+	for (const BlockDelta & d : other.m_blockDeltas) {
+		QHash<BlockHandle, int>::const_iterator it = m_movedBlocks.constFind(d.m_block);
+		if (it != m_movedBlocks.constEnd()) {
+			m_blockDeltas[it.value()].m_newPos = d.m_newPos;
+		}
+		else {
+			m_movedBlocks[d.m_block] = m_blockDeltas.count();
+			m_blockDeltas.append(d);
+		}
+	}
+	for (const ConnectorDelta & d : other.m_connectorDeltas) {
+		QHash<ConnectorHandle, int>::const_iterator it = m_movedConnectors.constFind(d.m_connector);
+		if (it != m_movedConnectors.constEnd()) {
+			ConnectorDelta & existing = m_connectorDeltas[it.value()];
+			existing.m_newSegments = d.m_newSegments;
+			existing.m_hasSegments = existing.m_hasSegments && d.m_hasSegments;
+		}
+		else {
+			m_movedConnectors[d.m_connector] = m_connectorDeltas.count();
+			m_connectorDeltas.append(d);
+		}
+	}
+}
+
+} // namespace BLOCKMOD
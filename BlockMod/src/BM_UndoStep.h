@@ -0,0 +1,136 @@
+/*	BSD 3-Clause License
+
+	This file is part of the BlockMod Library.
+
+	Copyright (c) 2019, Andreas Nicolai
+	All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	1. Redistributions of source code must retain the above copyright notice, this
+	   list of conditions and the following disclaimer.
+
+	2. Redistributions in binary form must reproduce the above copyright notice,
+	   this list of conditions and the following disclaimer in the documentation
+	   and/or other materials provided with the distribution.
+
+	3. Neither the name of the copyright holder nor the names of its
+	   contributors may be used to endorse or promote products derived from
+	   this software without specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+	DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+	FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+	DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+	SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+	CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+	OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+	OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BM_UndoStepH
+#define BM_UndoStepH
+
+#include <QHash>
+#include <QList>
+#include <QPointF>
+#include <QString>
+
+#include "BM_Block.h"
+#include "BM_Connector.h"
+#include "BM_NetworkChangeSet.h"
+
+namespace BLOCKMOD {
+
+class Network;
+
+/*! Stores the inverse deltas of a single operation of the SceneManager, used by its undo/redo stack.
+	Only changed data is stored: old and new positions of moved blocks, old and new segments of changed connectors,
+	old and new names of renamed blocks, and copies of added and removed blocks and connectors.
+*/
+class UndoStep {
+public:
+	/*! Delta of a single block. */
+	struct BlockDelta {
+		NetworkChangeSet::ChangeType	m_type;
+		/*! Handle of the block when the delta was recorded (see SceneManager for mapping of re-created blocks). */
+		BlockHandle						m_block;
+		/*! Copy of the block (Added and Removed only). */
+		Block							m_data;
+		/*! Positions before and after the operation (Moved only). */
+		QPointF							m_oldPos;
+		QPointF							m_newPos;
+		/*! Names before and after the operation (Renamed only). */
+		QString							m_oldName;
+		QString							m_newName;
+	};
+
+	/*! Delta of a single connector. */
+	struct ConnectorDelta {
+		NetworkChangeSet::ChangeType	m_type;
+		/*! Handle of the connector when the delta was recorded. */
+		ConnectorHandle					m_connector;
+		/*! Copy of the connector with flat socket names instead of socket handles (Added and Removed only). */
+		Connector						m_data;
+		/*! If false, the segments before the operation are unknown and the connector is adjusted instead. */
+		bool							m_hasSegments;
+		/*! Segments before and after the operation (Moved only). */
+		QList<Connector::Segment>		m_oldSegments;
+		QList<Connector::Segment>		m_newSegments;
+	};
+
+	UndoStep() : m_open(false) {}
+
+	/*! Returns true if no deltas are stored. */
+	bool isEmpty() const { return m_blockDeltas.isEmpty() && m_connectorDeltas.isEmpty(); }
+
+	/*! Returns true if all deltas are of type Moved (such steps can be merged). */
+	bool isMoveOnly() const;
+
+	/*! Stores the segments of the connector, unless already captured in this step.
+		Must be called before the segments of a connector are modified.
+	*/
+	void captureConnector(const ConnectorHandle & handle, const Connector & con);
+
+	/*! Appends a block delta. For Added and Removed, a copy of the block is stored.
+		Only the first move of a block is recorded, the new position is set in finish().
+	*/
+	void recordBlock(NetworkChangeSet::ChangeType type, const BlockHandle & handle, const Block & block,
+					 const QPointF & oldPos, const QString & oldName);
+
+	/*! Appends a connector delta. For Added and Removed, a copy of the connector with the given flat
+		socket names is stored. Moved connectors use the segments stored with captureConnector().
+	*/
+	void recordConnector(NetworkChangeSet::ChangeType type, const ConnectorHandle & handle, const Connector & con,
+						 const QString & sourceSocket, const QString & targetSocket);
+
+	/*! Completes the step: stores new positions of moved blocks and new segments of changed connectors. */
+	void finish(const Network & network);
+
+	/*! Merges the deltas of a following move-only step into this step.
+		Blocks and connectors contained in both steps keep their old state and receive the new state of other.
+	*/
+	void merge(const UndoStep & other);
+
+	/*! Block deltas, in the order of the changes. */
+	QList<BlockDelta>		m_blockDeltas;
+	/*! Connector deltas, in the order of the changes. */
+	QList<ConnectorDelta>	m_connectorDeltas;
+	/*! If true, the step was recorded while the mouse was dragging, following move-only steps are merged. */
+	bool					m_open;
+
+private:
+	/*! Index of Moved delta in m_blockDeltas for each block. */
+	QHash<BlockHandle, int>		m_movedBlocks;
+	/*! Index of Moved delta in m_connectorDeltas for each connector. */
+	QHash<ConnectorHandle, int>	m_movedConnectors;
+	/*! Segments of connectors before their first modification in this step (cleared in finish()). */
+	QHash<ConnectorHandle, QList<Connector::Segment> >	m_capturedSegments;
+};
+
+} // namespace BLOCKMOD
+
+#endif // BM_UndoStepH
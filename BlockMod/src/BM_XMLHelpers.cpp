@@ -37,6 +37,8 @@
 #include <QCoreApplication>
 #include <QStringList>
 
+#include <cstring>
+
 namespace BLOCKMOD {
 
 // helper function for reading XML file
@@ -152,6 +154,124 @@ void readNamedString(QXmlStreamReader & reader, QString & name, QString & val) {
 }
 
 
+/*! Returns true, if data contains the string str at position pos. */
+static bool startsWithAt(const QByteArray & data, int pos, const char * str) {
+	int len = (int)std::strlen(str);
+	return pos + len <= data.size() && std::memcmp(data.constData() + pos, str, (size_t)len) == 0;
+}
+
+
+bool scanXMLSections(const QByteArray & data, const QList<QByteArray> & sectionNames, QList<XMLSectionRange> & sections) {
+	sections.clear();
+	const char * d = data.constData();
+	const int size = data.size();
+	// byte order marks of UTF-16/UTF-32 files (UTF-8 byte order mark is ok)
+	if (size >= 2 && ((uchar)d[0] == 0xFE || (uchar)d[0] == 0xFF || d[0] == 0 || d[1] == 0))
+		return false;
+
+	int depth = 0;		// number of currently open elements
+	int current = -1;	// index of section that is currently scanned
+	int pos = 0;
+	for (;;) {
+		const char * p = static_cast<const char *>(std::memchr(d + pos, '<', (size_t)(size - pos)));
+		if (p == nullptr)
+			break;
+		pos = (int)(p - d);
+
+		if (startsWithAt(data, pos, "<!--")) {
+			pos = data.indexOf("-->", pos + 4);
+			if (pos == -1)
+				return false;
+			pos += 3;
+			continue;
+		}
+		if (startsWithAt(data, pos, "<![CDATA[")) {
+			pos = data.indexOf("]]>", pos + 9);
+			if (pos == -1)
+				return false;
+			pos += 3;
+			continue;
+		}
+		if (startsWithAt(data, pos, "<?")) {
+			int end = data.indexOf("?>", pos + 2);
+			if (end == -1)
+				return false;
+			// in the XML declaration, only UTF-8 encoding is accepted
+			if (startsWithAt(data, pos, "<?xml ")) {
+				QByteArray decl = data.mid(pos, end - pos).toLower();
+				int encPos = decl.indexOf("encoding");
+				if (encPos != -1 && decl.indexOf("utf-8", encPos) == -1)
+					return false;
+			}
+			pos = end + 2;
+			continue;
+		}
+		// DOCTYPE may define entities, which are not known when parsing chunks
+		if (startsWithAt(data, pos, "<!"))
+			return false;
+
+		if (startsWithAt(data, pos, "</")) {
+			--depth;
+			if (depth < 0)
+				return false;
+			if (current != -1 && depth == 1) {
+				sections[current].m_contentEnd = pos;
+				current = -1;
+			}
+			p = static_cast<const char *>(std::memchr(d + pos, '>', (size_t)(size - pos)));
+			if (p == nullptr)
+				return false;
+			pos = (int)(p - d) + 1;
+			continue;
+		}
+
+		// start tag, determine name and end of tag (attribute values may contain '>')
+		int nameBegin = pos + 1;
+		int i = nameBegin;
+		while (i < size && d[i] != ' ' && d[i] != '\t' && d[i] != '\n' && d[i] != '\r' && d[i] != '/' && d[i] != '>')
+			++i;
+		int nameEnd = i;
+		char quote = 0;
+		for (; i < size; ++i) {
+			char c = d[i];
+			if (quote != 0) {
+				if (c == quote)
+					quote = 0;
+			}
+			else if (c == '"' || c == '\'')
+				quote = c;
+			else if (c == '>')
+				break;
+		}
+		if (i == size)
+			return false;
+		bool selfClosing = (d[i-1] == '/');
+
+		if (depth == 2 && current != -1) {
+			sections[current].m_childBegins.append(pos);
+		}
+		else if (depth == 1 && !selfClosing) {
+			QByteArray name = QByteArray::fromRawData(d + nameBegin, nameEnd - nameBegin);
+			if (sectionNames.contains(name)) {
+				for (const XMLSectionRange & s : sections)
+					if (s.m_name == name)
+						return false; // section appears more than once
+				XMLSectionRange range;
+				range.m_name = QByteArray(d + nameBegin, nameEnd - nameBegin);
+				range.m_contentBegin = i + 1;
+				range.m_contentEnd = -1;
+				sections.append(range);
+				current = sections.count() - 1;
+			}
+		}
+		if (!selfClosing)
+			++depth;
+		pos = i + 1;
+	}
+	return depth == 0 && current == -1;
+}
+
+
 QString encodePoint(const QPointF & p) {
 	return QString("%1, %2").arg(p.x()).arg(p.y());
 }
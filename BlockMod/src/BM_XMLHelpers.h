@@ -40,11 +40,16 @@ class QString;
 
 #include <QPointF>
 #include <QList>
+#include <QVector>
+#include <QByteArray>
 #include <QXmlStreamReader>
 
 #include <vector>
+#include <list>
 #include <stdexcept>
 
+#include "BM_SlotMap.h"
+
 namespace BLOCKMOD {
 
 /*! Helper function for XML readers. Reads unknown XML elements recursively.
@@ -126,12 +131,13 @@ void readList(QXmlStreamReader & reader, QList<T> & typeList) {
 		// process elements and attributes
 		if (reader.isStartElement()) {
 			++count;
-			// start reading the type
-			T tmp;
-			tmp.readXML(reader);
-			if (reader.hasError())
+			// construct element in list and read its content in place
+			typeList.append(T());
+			typeList.last().readXML(reader);
+			if (reader.hasError()) {
+				typeList.removeLast();
 				break;
-			typeList.append(tmp);
+			}
 		}
 		else if (reader.isEndElement()) {
 			break; // done with type list
@@ -149,12 +155,37 @@ void readList(QXmlStreamReader & reader, std::list<T> & typeList) {
 		// process elements and attributes
 		if (reader.isStartElement()) {
 			++count;
-			// start reading the type
-			T tmp;
-			tmp.readXML(reader);
-			if (reader.hasError())
+			// construct element in list and read its content in place
+			typeList.emplace_back();
+			typeList.back().readXML(reader);
+			if (reader.hasError()) {
+				typeList.pop_back();
+				break;
+			}
+		}
+		else if (reader.isEndElement()) {
+			break; // done with type list
+		}
+	}
+}
+
+// templated function that works with all types of lists
+template <typename T>
+void readList(QXmlStreamReader & reader, SlotMap<T> & typeList) {
+	// then read all the subsections
+	int count = 0;
+	while (!reader.atEnd() && !reader.hasError()) {
+		reader.readNext();
+		// process elements and attributes
+		if (reader.isStartElement()) {
+			++count;
+			// construct element in list and read its content in place
+			typeList.emplace_back();
+			typeList.back().readXML(reader);
+			if (reader.hasError()) {
+				typeList.pop_back();
 				break;
-			typeList.push_back(tmp);
+			}
 		}
 		else if (reader.isEndElement()) {
 			break; // done with type list
@@ -162,6 +193,30 @@ void readList(QXmlStreamReader & reader, std::list<T> & typeList) {
 	}
 }
 
+/*! Location of a section element (element directly below the root element) in raw XML data,
+	see scanXMLSections().
+*/
+struct XMLSectionRange {
+	/*! Tag name of the section element. */
+	QByteArray		m_name;
+	/*! Byte offset of the section content (first byte after the start tag). */
+	int				m_contentBegin;
+	/*! Byte offset of the section's end tag. */
+	int				m_contentEnd;
+	/*! Byte offsets of the start tags of all child elements of the section. */
+	QVector<int>	m_childBegins;
+};
+
+/*! Scans raw XML data for the section elements with the given names and locates their child elements,
+	without actually parsing the XML content. This is used to split large documents into chunks that can
+	be parsed independently.
+	Comments, CDATA sections and processing instructions are skipped.
+	\return Returns false if the data cannot be split safely, i.e. if the document is not UTF-8 encoded,
+		contains a DTD, a section appears more than once or the data is not well-formed. In this case
+		the document must be parsed sequentially.
+*/
+bool scanXMLSections(const QByteArray & data, const QList<QByteArray> & sectionNames, QList<XMLSectionRange> & sections);
+
 /*! Encodes a point representation. */
 QString encodePoint(const QPointF & p);
 
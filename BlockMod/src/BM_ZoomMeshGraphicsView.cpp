@@ -38,6 +38,7 @@
 #include <QGraphicsItem>
 #include <QDebug>
 #include <QApplication>
+#include <QPainter>
 
 #include <cmath>
 
@@ -45,6 +46,9 @@
 
 namespace BLOCKMOD {
 
+/*! Edge length of the tiles of the cached static layer (two-layer mode) in device-independent pixels. */
+static const int LayerTileSize = 256;
+
 ZoomMeshGraphicsView::ZoomMeshGraphicsView(QWidget *parent) :
 	QGraphicsView(parent),
 	m_resolution(1000), // 1000 px/m
@@ -52,12 +56,18 @@ ZoomMeshGraphicsView::ZoomMeshGraphicsView(QWidget *parent) :
 	m_gridEnabled( true ),
 	m_zoomLevel(0),
 	m_gridColor( 175, 175, 255 ),
-	m_gridSpacingPixLast(0)
+	m_gridTileSpacing(0),
+	m_gridTileDevicePixelRatio(1),
+	m_layerCacheActive(false),
+	m_layerTileColumns(0),
+	m_layerDevicePixelRatio(1)
 {
 	setTransformationAnchor(AnchorUnderMouse);
 
-	// this saves our overlays while drawing
-	setViewportUpdateMode( QGraphicsView::FullViewportUpdate );
+	// only repaint the regions of changed items; this requires exact bounding rects of all items
+	setViewportUpdateMode( QGraphicsView::SmartViewportUpdate );
+	// grid is drawn in drawBackground(), when panning only the newly exposed areas are drawn
+	setCacheMode(QGraphicsView::CacheBackground);
 }
 
 
@@ -77,105 +87,113 @@ void ZoomMeshGraphicsView::wheelEvent(QWheelEvent *i_event){
 
 void ZoomMeshGraphicsView::paintEvent(QPaintEvent *i_event){
 
-	if (m_gridEnabled) {
-
-		// get rect
-		QPainter p(viewport());
-		QPointF p1 = mapFromScene( QPointF(0,0) );
-
-		// compute nominal pixels using resolution
-		double gridSpacingPix = m_resolution*m_gridStep;
-
-		// apply scaling
-		double scaleFactor = transform().m11();
-		gridSpacingPix *= scaleFactor;
-
-		// get dimensions
-		int h = height();
-		int w = width();
-		QSize windowSize(w,h);
-
-		// if new reference point, grid scale factor and window size still match cached values, do
-		// not recompute grid lines
-		if (gridSpacingPix != m_gridSpacingPixLast ||
-			p1 != m_pLast ||
-			windowSize != m_windowSizeLast)
-		{
-
-			// cache values used for calculation
-			m_pLast = p1;
-			m_gridSpacingPixLast = gridSpacingPix;
-			m_windowSizeLast = windowSize;
-
-			// *** major grid ***
+	// two-layer mode: while the scene manager is in an interaction, the static layer is cached
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	bool layered = sceneManager != nullptr && sceneManager->isInteractionActive();
+	if (layered != m_layerCacheActive) {
+		m_layerCacheActive = layered;
+		m_layerTiles.clear();
+		// static layer tiles are drawn as part of the (cached) background
+		resetCachedContent();
+		// with indirect painting, items are painted through the scene's drawItems(), which filters the layers
+		setOptimizationFlag(QGraphicsView::IndirectPainting, layered);
+	}
 
-			// clear major grid lines
-			m_majorGrid.clear();
+	if (layered) {
+		sceneManager->setLayerFilter(SceneManager::LiveLayer);
+		QGraphicsView::paintEvent(i_event);
+		sceneManager->setLayerFilter(SceneManager::AllLayers);
+	}
+	else
+		QGraphicsView::paintEvent(i_event);
+}
 
-			// only regenerate mesh and draw grid if spacing is big enough
-			if (gridSpacingPix >= 5) {
 
-				// calculate offset - we start at 0 pix in scaled scene coordinates
-				int linesXTillView = std::floor(-p1.x()/gridSpacingPix + 1);
-				double offsetX = linesXTillView*gridSpacingPix + p1.x();
+void ZoomMeshGraphicsView::drawBackground(QPainter * painter, const QRectF & rect) {
+	QGraphicsView::drawBackground(painter, rect);
 
-				int linesYTillView = std::floor(-p1.y()/gridSpacingPix + 1);
-				double offsetY = linesYTillView*gridSpacingPix + p1.y();
+	// remaining drawing is done in viewport coordinates
+	QRect exposedRect = painter->worldTransform().mapRect(rect).toAlignedRect();
+	QPointF origin = painter->worldTransform().map(QPointF(0,0));
+	painter->save();
+	painter->resetTransform();
 
-				for (double x = offsetX; x < w; x += gridSpacingPix) {
-					m_majorGrid.append(QLineF(x, 0, x, h));
-				}
-				for (double y = offsetY; y < h; y += gridSpacingPix) {
-					m_majorGrid.append(QLineF(0, y, w, y));
-				}
+	if (m_gridEnabled) {
+		// compute nominal pixels using resolution and apply scaling
+		double gridSpacingPix = m_resolution*m_gridStep*transform().m11();
+		updateGridTile(gridSpacingPix, painter->device()->devicePixelRatioF());
+		if (!m_gridTile.isNull()) {
+			if (std::fabs(gridSpacingPix - std::round(gridSpacingPix)) < 1e-6) {
+				// integral spacing: tile repeats exactly, fill with texture brush
+				QBrush brush(m_gridTile);
+				brush.setTransform(QTransform::fromTranslate(qRound(origin.x()), qRound(origin.y())));
+				painter->fillRect(exposedRect, brush);
 			}
+			else {
+				// fractional spacing: a repeated tile would drift against the blocks, so the tile is drawn per cell
+				// at the rounded cell position (same rounding as for individual lines)
+				// grid cells overlapping the exposed rect, the cell at the scene origin has index 0
+				int firstX = (int)std::floor((exposedRect.left() - origin.x())/gridSpacingPix);
+				int lastX = (int)std::floor((exposedRect.right() - origin.x())/gridSpacingPix);
+				int firstY = (int)std::floor((exposedRect.top() - origin.y())/gridSpacingPix);
+				int lastY = (int)std::floor((exposedRect.bottom() - origin.y())/gridSpacingPix);
+				for (int x = firstX; x <= lastX; ++x)
+					for (int y = firstY; y <= lastY; ++y)
+						painter->drawPixmap(QPoint(qRound(origin.x() + x*gridSpacingPix), qRound(origin.y() + y*gridSpacingPix)),
+											m_gridTile);
+			}
+		}
+	}
 
+	if (m_layerCacheActive && qobject_cast<SceneManager *>(scene()) != nullptr) {
+		updateLayerTiles(exposedRect);
+		// tiles are positioned in viewport coordinates
+		for (int i=0; i<m_layerTiles.count(); ++i) {
+			const QPixmap & tile = m_layerTiles[i];
+			if (tile.isNull())
+				continue;
+			QPoint topLeft((i % m_layerTileColumns)*LayerTileSize, (i / m_layerTileColumns)*LayerTileSize);
+			if (exposedRect.intersects(QRect(topLeft, QSize(LayerTileSize, LayerTileSize))))
+				painter->drawPixmap(topLeft, tile);
+		}
+	}
+	painter->restore();
+}
 
-			// *** minor grid ***
-
-			// compute nominal pixels using resolution, this time for minor grid
-			gridSpacingPix = m_resolution*m_gridStep*0.1;
-
-			// apply scaling
-			scaleFactor = transform().m11();
-			gridSpacingPix *= scaleFactor;
-
-			// clear minor grid lines
-			m_minorGrid.clear();
-
-			// only draw grid if spacing is big enough
-			if (gridSpacingPix >= 5) {
 
-				// calculate offset - we start at 0 pix in scaled scene coordinates
-				int linesXTillView = std::floor(-p1.x()/gridSpacingPix + 1);
-				double offsetX = linesXTillView*gridSpacingPix + p1.x();
+void ZoomMeshGraphicsView::scrollContentsBy(int dx, int dy) {
+	QGraphicsView::scrollContentsBy(dx, dy);
+	visibleAreaChanged();
+}
 
-				int linesYTillView = std::floor(-p1.y()/gridSpacingPix + 1);
-				double offsetY = linesYTillView*gridSpacingPix + p1.y();
 
-				// create a vector of lines to draw
-				m_minorGrid.clear();
+void ZoomMeshGraphicsView::resizeEvent(QResizeEvent *event) {
+	QGraphicsView::resizeEvent(event);
+	visibleAreaChanged();
+}
 
-				for (double x = offsetX; x < w; x += gridSpacingPix) {
-					m_minorGrid.append(QLineF(x, 0, x, h));
-				}
-				for (double y = offsetY; y < h; y += gridSpacingPix) {
-					m_minorGrid.append(QLineF(0, y, w, y));
-				}
 
+void ZoomMeshGraphicsView::invalidateLayerCache(const QRectF & sceneRect) {
+	if (m_layerTiles.isEmpty())
+		return;
+	// tiles are part of the cached background
+	if (sceneRect.isNull()) {
+		m_layerTiles.clear();
+		resetCachedContent();
+		viewport()->update();
+	}
+	else {
+		QRect r = m_layerTransform.mapRect(sceneRect).toAlignedRect();
+		for (int i=0; i<m_layerTiles.count(); ++i) {
+			QRect tileRect((i % m_layerTileColumns)*LayerTileSize, (i / m_layerTileColumns)*LayerTileSize,
+						   LayerTileSize, LayerTileSize);
+			if (r.intersects(tileRect)) {
+				m_layerTiles[i] = QPixmap();
+				// the entire tile is rendered again, so the entire tile must be redrawn
+				invalidateScene(m_layerTransform.inverted().mapRect(QRectF(tileRect)), QGraphicsScene::BackgroundLayer);
 			}
 		}
-		// we paint in view coordinates
-		p.setPen( QColor(220,220,255) );
-		p.drawLines(m_minorGrid.data(), m_minorGrid.size());
-
-		// we paint in view coordinates
-		p.setPen( m_gridColor );
-		p.drawLines(m_majorGrid.data(), m_majorGrid.size());
-
 	}
-
-	QGraphicsView::paintEvent(i_event);
 }
 
 
@@ -206,18 +224,19 @@ void ZoomMeshGraphicsView::leaveEvent(QEvent *event) {
 void ZoomMeshGraphicsView::mouseMoveEvent(QMouseEvent *i_event) {
 	QGraphicsView::mouseMoveEvent(i_event);
 	m_pos = mapToScene(i_event->pos());
-	viewport()->update();
 }
 
 
 void ZoomMeshGraphicsView::setGridColor( QColor color ) {
 	m_gridColor = color;
+	resetCachedContent();
 	viewport()->update();
 }
 
 
 void ZoomMeshGraphicsView::setGridEnabled( bool enabled ) {
 	m_gridEnabled = enabled;
+	resetCachedContent();
 	viewport()->update();
 }
 
@@ -229,6 +248,7 @@ void ZoomMeshGraphicsView::zoomIn() {
 	QTransform m(factor, 0, 0, factor, 0, 0);
 	setTransform(m);
 	changeResolutionEvent();
+	visibleAreaChanged();
 
 }
 
@@ -240,6 +260,7 @@ void ZoomMeshGraphicsView::zoomOut() {
 	QTransform m(factor, 0, 0, factor, 0, 0);
 	setTransform(m);
 	changeResolutionEvent();
+	visibleAreaChanged();
 
 }
 
@@ -253,6 +274,7 @@ void ZoomMeshGraphicsView::setZoomLevel(int zoomLevel) {
 	QTransform m(factor, 0, 0, factor, 0, 0);
 	setTransform(m);
 	changeResolutionEvent();
+	visibleAreaChanged();
 
 }
 
@@ -261,6 +283,7 @@ void ZoomMeshGraphicsView::resetZoom() {
 
 	m_zoomLevel = 0;
 	resetTransform();
+	visibleAreaChanged();
 
 }
 
@@ -268,6 +291,7 @@ void ZoomMeshGraphicsView::resetZoom() {
 void ZoomMeshGraphicsView::setGridStep(double gridStep) {
 	if (gridStep <=0) return;
 	m_gridStep = gridStep;
+	resetCachedContent();
 	viewport()->update();
 }
 
@@ -275,7 +299,93 @@ void ZoomMeshGraphicsView::setGridStep(double gridStep) {
 void ZoomMeshGraphicsView::setResolution(double res) {
 	if (res <=0) return;
 	m_resolution = res;
+	resetCachedContent();
 	viewport()->update();
 }
 
+
+void ZoomMeshGraphicsView::visibleAreaChanged() {
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	if (sceneManager != nullptr)
+		sceneManager->updateVisibleArea();
+}
+
+void ZoomMeshGraphicsView::updateGridTile(double gridSpacingPix, qreal dpr) {
+	if (gridSpacingPix == m_gridTileSpacing && dpr == m_gridTileDevicePixelRatio && m_gridColor == m_gridTileColor)
+		return;
+	m_gridTileSpacing = gridSpacingPix;
+	m_gridTileDevicePixelRatio = dpr;
+	m_gridTileColor = m_gridColor;
+	m_gridTile = QPixmap();
+
+	// only draw grid if spacing is big enough
+	if (gridSpacingPix < 5)
+		return;
+
+	// the tile holds a single major grid cell, with the major grid lines at the top and left
+	int size = qRound(gridSpacingPix);
+	QPixmap tile(QSize(size, size)*dpr);
+	tile.setDevicePixelRatio(dpr);
+	tile.fill(Qt::transparent);
+	QPainter p(&tile);
+
+	// minor grid with 10 % of the major grid spacing, only if spacing is big enough
+	double minorSpacing = 0.1*gridSpacingPix;
+	if (minorSpacing >= 5) {
+		p.setPen( QColor(220,220,255) );
+		for (int i=1; i<10; ++i) {
+			int pos = qRound(i*minorSpacing);
+			p.drawLine(pos, 0, pos, size-1);
+			p.drawLine(0, pos, size-1, pos);
+		}
+	}
+
+	// major grid is drawn over the minor grid
+	p.setPen( m_gridColor );
+	p.drawLine(0, 0, size-1, 0);
+	p.drawLine(0, 0, 0, size-1);
+	p.end();
+	m_gridTile = tile;
+}
+
+
+void ZoomMeshGraphicsView::updateLayerTiles(const QRect & exposedRect) {
+	SceneManager * sceneManager = qobject_cast<SceneManager *>(scene());
+	QSize viewportSize = viewport()->size();
+	qreal dpr = viewport()->devicePixelRatioF();
+	QTransform transform = viewportTransform();
+	if (transform != m_layerTransform || viewportSize != m_layerViewportSize || dpr != m_layerDevicePixelRatio) {
+		m_layerTiles.clear();
+		m_layerTransform = transform;
+		m_layerViewportSize = viewportSize;
+		m_layerDevicePixelRatio = dpr;
+	}
+	m_layerTileColumns = (viewportSize.width() + LayerTileSize - 1)/LayerTileSize;
+	int rows = (viewportSize.height() + LayerTileSize - 1)/LayerTileSize;
+	if (m_layerTiles.isEmpty())
+		m_layerTiles.resize(m_layerTileColumns*rows);
+
+	// render the missing tiles with static items only
+	QTransform sceneTransform = transform.inverted();
+	sceneManager->setLayerFilter(SceneManager::StaticLayer);
+	for (int i=0; i<m_layerTiles.count(); ++i) {
+		if (!m_layerTiles[i].isNull())
+			continue;
+		QRect tileRect((i % m_layerTileColumns)*LayerTileSize, (i / m_layerTileColumns)*LayerTileSize,
+					   LayerTileSize, LayerTileSize);
+		if (!exposedRect.intersects(tileRect))
+			continue;
+		QPixmap tile(QSize(LayerTileSize, LayerTileSize)*dpr);
+		tile.setDevicePixelRatio(dpr);
+		tile.fill(Qt::transparent);
+		QPainter p(&tile);
+		p.setRenderHints(renderHints());
+		sceneManager->render(&p, QRectF(0, 0, LayerTileSize, LayerTileSize), sceneTransform.mapRect(QRectF(tileRect)),
+							 Qt::IgnoreAspectRatio);
+		m_layerTiles[i] = tile;
+	}
+	sceneManager->setLayerFilter(SceneManager::AllLayers);
+}
+
+
 } // namespace BLOCKMOD
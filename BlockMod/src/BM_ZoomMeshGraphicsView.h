@@ -35,9 +35,10 @@
 #define BM_ZoomMeshGraphicsViewH
 
 #include <QGraphicsView>
-#include <QVarLengthArray>
 #include <QWidget>
 #include <QColor>
+#include <QVector>
+#include <QPixmap>
 
 namespace BLOCKMOD {
 
@@ -86,6 +87,12 @@ public slots:
 	*/
 	void setResolution(double res);
 
+	/*! Two-layer mode: marks the cached static layer within the given rect (scene coordinates) as outdated,
+		affected tiles are rendered again on next repaint. A null rect invalidates all tiles.
+		Call this when items outside of the live layer change during an interaction.
+	*/
+	void invalidateLayerCache(const QRectF & sceneRect = QRectF());
+
 protected:
 	/*! Overloaded to set cross/arrow cursor, depending on connection-mode state of scene. */
 	void enterEvent(QEvent *event) override;
@@ -99,9 +106,23 @@ protected:
 	/*! Enables the zoom. */
 	void wheelEvent(QWheelEvent *i_event) override;
 
-	/*! Draws the mesh. */
+	/*! Paints the scene.
+		While the scene manager is in an interaction (two-layer mode, see SceneManager::setLayeredInteraction()),
+		only the live items are painted, all other items are taken from the cached static layer.
+	*/
 	void paintEvent(QPaintEvent *i_event) override;
 
+	/*! Re-implemented to draw the grid (from a pre-rendered tile) and, in two-layer mode, the cached static layer.
+		The result is cached by the view (CacheBackground), so that panning only draws the newly exposed areas.
+	*/
+	void drawBackground(QPainter * painter, const QRectF & rect) override;
+
+	/*! Re-implemented to inform the scene manager about the changed visible area. */
+	void scrollContentsBy(int dx, int dy) override;
+
+	/*! Re-implemented to inform the scene manager about the changed visible area. */
+	void resizeEvent(QResizeEvent *event) override;
+
 	/*! This event is called from this class and can be used in derived classes to
 		react on changes to the zoom factor. */
 	virtual void changeResolutionEvent() {}
@@ -119,25 +140,44 @@ protected:
 	int		m_zoomLevel;
 
 private:
+	/*! Tells the scene manager (if any) that the visible area has changed, so that items of a virtualized scene are updated. */
+	void visibleAreaChanged();
 
-	/*! The current mouse point. */
-	QPointF							m_pos;
+	/*! Renders the grid tile again, if grid spacing (in pixels), grid color or device pixel ratio have changed. */
+	void updateGridTile(double gridSpacingPix, qreal dpr);
 
-	/*! The major grid lines. */
-	QVarLengthArray<QLineF, 100>	m_majorGrid;
+	/*! Two-layer mode: renders all missing static layer tiles that intersect the given rect (viewport coordinates).
+		Tiles are discarded if the view transformation, viewport size or device pixel ratio changed.
+	*/
+	void updateLayerTiles(const QRect & exposedRect);
 
-	/*! The minor grid lines. */
-	QVarLengthArray<QLineF, 100>	m_minorGrid;
+	/*! The current mouse point. */
+	QPointF							m_pos;
 
 	/*! The grid color (major grid). */
 	QColor							m_gridColor;
 
-	/*! Cached reference point used during last grid update. */
-	QPointF							m_pLast;
-	/*! Cached grid spacing used during last grid update. */
-	double							m_gridSpacingPixLast;
-	/*! Cached window size used during last grid update. */
-	QSize							m_windowSizeLast;
+	/*! Pre-rendered grid tile (a single major grid cell including minor grid lines), null if grid is too dense. */
+	QPixmap							m_gridTile;
+	/*! Major grid spacing in pixels that m_gridTile was rendered for. */
+	double							m_gridTileSpacing;
+	/*! Grid color that m_gridTile was rendered with. */
+	QColor							m_gridTileColor;
+	/*! Device pixel ratio that m_gridTile was rendered for. */
+	qreal							m_gridTileDevicePixelRatio;
+
+	/*! True while the scene manager is in an interaction and the static layer is taken from the tiles. */
+	bool							m_layerCacheActive;
+	/*! Tiles of the static layer in rows of m_layerTileColumns, a null pixmap is not yet rendered. */
+	QVector<QPixmap>				m_layerTiles;
+	/*! Number of tile columns. */
+	int								m_layerTileColumns;
+	/*! Viewport transformation the tiles were rendered with. */
+	QTransform						m_layerTransform;
+	/*! Viewport size the tiles were created for. */
+	QSize							m_layerViewportSize;
+	/*! Device pixel ratio the tiles were rendered with. */
+	qreal							m_layerDevicePixelRatio;
 
 };
 
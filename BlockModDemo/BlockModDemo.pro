@@ -9,7 +9,7 @@ TEMPLATE = app
 # common project configurations, source this file after TEMPLATE was specified
 include( ../BlockMod/projects/Qt/BlockMod.pri )
 
-QT += widgets svg network xml printsupport
+QT += widgets svg network xml printsupport concurrent
 
 INCLUDEPATH = \
 	src \
@@ -5,11 +5,15 @@
 
 #include <QGridLayout>
 #include <QFileDialog>
-#include <QDebug>
+#include <QFileInfo>
+#include <QMessageBox>
 #include <QRandomGenerator>
+#include <QProgressDialog>
+#include <QShortcut>
 
 #include <BM_SceneManager.h>
 #include <BM_Network.h>
+#include <BM_NetworkLoader.h>
 #include <BM_BlockItem.h>
 #include <BM_ConnectorSegmentItem.h>
 #include <BM_Globals.h>
@@ -17,7 +21,9 @@
 BlockModDemoDialog::BlockModDemoDialog(QWidget *parent) :
 	QDialog(parent, Qt::Window | Qt::WindowMinMaxButtonsHint | Qt::WindowCloseButtonHint),
 	ui(new Ui::BlockModDemoDialog),
-	m_sceneManager(new BLOCKMOD::SceneManager(this))
+	m_sceneManager(new BLOCKMOD::SceneManager(this)),
+	m_networkLoader(new BLOCKMOD::NetworkLoader(this)),
+	m_progressDialog(nullptr)
 {
 	ui->setupUi(this);
 	ui->gridLayout_2->setColumnStretch(0,1);
@@ -27,6 +33,22 @@ BlockModDemoDialog::BlockModDemoDialog(QWidget *parent) :
 	ui->graphicsView->setScene(m_sceneManager);
 	ui->graphicsView->setResolution(1); // in pix/m
 	ui->graphicsView->setGridStep(80); // 80 pix/m; 8 pix/m for small grid
+	// while dragging, only the dragged blocks and their connectors are repainted
+	m_sceneManager->setLayeredInteraction(true);
+	// connectors of dragged blocks are updated once per frame
+	m_sceneManager->setCoalescedDragUpdates(true);
+	// built-in undo/redo
+	m_sceneManager->setUndoEnabled(true);
+	connect(new QShortcut(QKeySequence::Undo, this), &QShortcut::activated, m_sceneManager, &BLOCKMOD::SceneManager::undo);
+	connect(new QShortcut(QKeySequence::Redo, this), &QShortcut::activated, m_sceneManager, &BLOCKMOD::SceneManager::redo);
+
+	connect(m_networkLoader, &BLOCKMOD::NetworkLoader::progress, this, &BlockModDemoDialog::onLoadProgress);
+	connect(m_networkLoader, &BLOCKMOD::NetworkLoader::finished, this, &BlockModDemoDialog::onLoadFinished);
+	connect(m_networkLoader, &BLOCKMOD::NetworkLoader::failed, this, &BlockModDemoDialog::onLoadFailed);
+	connect(m_networkLoader, &BLOCKMOD::NetworkLoader::cancelled, [this]() {
+		delete m_progressDialog;
+		m_progressDialog = nullptr;
+	});
 
 	loadNetwork("demo.bm");
 
@@ -47,7 +69,7 @@ void BlockModDemoDialog::on_toolButtonNew_clicked() {
 
 
 void BlockModDemoDialog::on_toolButtonOpen_clicked() {
-	QString fname = QFileDialog::getOpenFileName(this, tr("Select BlockMod file"), QString(), tr("BlockMod files (*.bm)"));
+	QString fname = QFileDialog::getOpenFileName(this, tr("Select BlockMod file"), QString(), tr("BlockMod files (*.bm *.bmb)"));
 	if (fname.isEmpty())
 		return;
 	loadNetwork(fname);
@@ -55,33 +77,60 @@ void BlockModDemoDialog::on_toolButtonOpen_clicked() {
 
 
 void BlockModDemoDialog::on_toolButtonSave_clicked() {
-	QString fname = QFileDialog::getSaveFileName(this, tr("Select BlockMod file"), QString(), tr("BlockMod files (*.bm)"));
+	QString fname = QFileDialog::getSaveFileName(this, tr("Select BlockMod file"), QString(),
+												 tr("BlockMod files (*.bm);;BlockMod binary files (*.bmb)"));
 	if (fname.isEmpty())
 		return;
-	m_sceneManager->network().writeXML(fname);
+	// binary format is selected by file extension
+	if (QFileInfo(fname).suffix() == "bmb")
+		m_sceneManager->network().writeBinary(fname);
+	else
+		m_sceneManager->network().writeXML(fname);
 }
 
 
 void BlockModDemoDialog::loadNetwork(const QString & fname) {
-	BLOCKMOD::Network n;
-	try {
-		n.readXML(fname);
-		n.checkNames();
-		std::list<BLOCKMOD::Connector> checkedCons;
-		// remove invalid connections and fix any connectors that might miss a bit
-		for (BLOCKMOD::Connector & con : n.m_connectors) {
-			try {
-				n.adjustConnector(con);
-				checkedCons.push_back(con);
-			}
-			catch (...) {}
-		}
-		n.m_connectors.swap(checkedCons);
-		m_sceneManager->setNetwork(n); // network is copied
-	} catch (std::runtime_error & e) {
-		QString errormsg(e.what());
-		qDebug() << errormsg;
+	// file is read, checked and connectors are adjusted in background, the GUI stays responsive
+	// (a running load is cancelled first, which deletes its progress dialog, so the dialog is created afterwards)
+	m_networkLoader->load(fname);
+	if (m_progressDialog == nullptr) {
+		m_progressDialog = new QProgressDialog(this);
+		m_progressDialog->setWindowModality(Qt::WindowModal);
+		m_progressDialog->setMinimumDuration(500);
+		connect(m_progressDialog, &QProgressDialog::canceled, m_networkLoader, &BLOCKMOD::NetworkLoader::cancel);
 	}
+	m_progressDialog->setLabelText(tr("Reading '%1'...").arg(QFileInfo(fname).fileName()));
+	m_progressDialog->setValue(0);
+}
+
+
+void BlockModDemoDialog::onLoadProgress(int stage, qint64 processed, qint64 total) {
+	if (m_progressDialog == nullptr)
+		return;
+	if (stage == BLOCKMOD::NetworkLoader::AdjustingConnectors)
+		m_progressDialog->setLabelText(tr("Adjusting connectors..."));
+	// first half of progress bar for reading, second half for adjusting connectors
+	int percent = total > 0 ? (int)(processed*100/total) : 100;
+	m_progressDialog->setValue(stage*50 + percent/2);
+}
+
+
+void BlockModDemoDialog::onLoadFinished() {
+	delete m_progressDialog;
+	m_progressDialog = nullptr;
+	BLOCKMOD::Network n = m_networkLoader->takeNetwork();
+	// very large networks only get items for the visible area
+	m_sceneManager->setVirtualized(n.m_blocks.size() > 10000);
+	// network is moved, not copied; items in the visible area are created first
+	m_sceneManager->setNetworkIncremental(std::move(n));
+}
+
+
+void BlockModDemoDialog::onLoadFailed(const QString & errorMessage) {
+	// progress dialog is removed before the message box is shown, next load starts with a fresh dialog
+	delete m_progressDialog;
+	m_progressDialog = nullptr;
+	QMessageBox::critical(this, tr("Error reading network"), errorMessage);
 }
 
 
@@ -89,9 +138,7 @@ void BlockModDemoDialog::on_pushButtonRemoveBlock_clicked() {
 	// find out selected blocks
 
 	QList<const BLOCKMOD::Block *> selectedBlocks = m_sceneManager->selectedBlocks();
-	for (const BLOCKMOD::Block * bi : selectedBlocks) {
-		m_sceneManager->removeBlock(bi);
-	}
+	m_sceneManager->removeBlocks(selectedBlocks);
 }
 
 
@@ -7,8 +7,11 @@ namespace Ui {
 class BlockModDemoDialog;
 }
 
+class QProgressDialog;
+
 namespace BLOCKMOD {
 	class SceneManager;
+	class NetworkLoader;
 }
 
 class BlockModDemoDialog : public QDialog {
@@ -31,12 +34,24 @@ private slots:
 
 	void on_pushButtonAddBlock_clicked();
 
+	/*! Connected to NetworkLoader::progress(), updates the progress dialog. */
+	void onLoadProgress(int stage, qint64 processed, qint64 total);
+	/*! Connected to NetworkLoader::finished(), transfers the loaded network into the scene. */
+	void onLoadFinished();
+	/*! Connected to NetworkLoader::failed(). */
+	void onLoadFailed(const QString & errorMessage);
+
 private:
 	void loadNetwork(const QString & fname);
 
 	Ui::BlockModDemoDialog	*ui;
 
 	BLOCKMOD::SceneManager	*m_sceneManager;
+
+	/*! Loads networks in background. */
+	BLOCKMOD::NetworkLoader	*m_networkLoader;
+	/*! Shows the loading progress and allows cancelling the load, only exists while loading. */
+	QProgressDialog			*m_progressDialog;
 };
 
 #endif // BLOCKMODEDEMODIALOG_H
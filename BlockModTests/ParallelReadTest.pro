@@ -0,0 +1,30 @@
+# ----------------------------------------------------
+# Project for ParallelReadTest
+# remember to set DYLD_FALLBACK_LIBRARY_PATH on MacOSX
+# ----------------------------------------------------
+
+TARGET = ParallelReadTest
+TEMPLATE = app
+
+# common project configurations, source this file after TEMPLATE was specified
+include( ../BlockMod/projects/Qt/BlockMod.pri )
+
+QT += widgets svg network xml printsupport concurrent
+
+INCLUDEPATH = \
+	src \
+	../BlockMod/src
+
+DEPENDPATH = $${INCLUDEPATH}
+
+LIBS += -L../lib \
+	-lBlockMod
+
+SOURCES += \
+	src/ParallelReadTest.cpp \
+	src/NetworkGenerator.cpp
+
+HEADERS += \
+	src/NetworkGenerator.h
+
+
@@ -0,0 +1,316 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <BM_Network.h>
+#include <BM_SceneManager.h>
+#include <BM_BlockItem.h>
+#include <BM_Globals.h>
+
+#include "NetworkGenerator.h"
+
+/*! A single timing result. */
+struct BenchResult {
+	QString				m_name;
+	NetworkParameters	m_params;
+	int					m_connectors;
+	/*! Measured times in ms, one per repetition. */
+	QList<double>		m_times;
+};
+
+
+/*! Runs all benchmarks for a single network size and appends the results. */
+void runBenchmarks(const NetworkParameters & p, int repeat, int dragSteps, int removeCount, bool withScene,
+				   const QString & tmpDir, QList<BenchResult> & results)
+{
+	const char * const NAMES[] = {
+		"generate", "adjustConnectors", "checkNames", "writeXML", "readXML", "readXMLParallel",
+		"writeBinary", "readBinary", "setNetwork", "setNetworkIncremental", "drag", "removeBlock",
+		"renderZoomedOut", "snapshot"
+	};
+	const int BENCH_COUNT = withScene ? 14 : 8;
+	QList<BenchResult> res;
+	for (int i=0; i<BENCH_COUNT; ++i) {
+		BenchResult r;
+		r.m_name = NAMES[i];
+		r.m_params = p;
+		r.m_connectors = 0;
+		res.append(r);
+	}
+
+	QString fname = tmpDir + QString("/bench_%1.bm").arg(p.m_blocks);
+	QString binaryFname = tmpDir + QString("/bench_%1.bmb").arg(p.m_blocks);
+	QElapsedTimer timer;
+	for (int rep=0; rep<repeat; ++rep) {
+		BLOCKMOD::Network network;
+
+		timer.start();
+		generateNetwork(p, network);
+		res[0].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		timer.start();
+		network.adjustConnectors();
+		res[1].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		timer.start();
+		network.checkNames();
+		res[2].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		timer.start();
+		network.writeXML(fname);
+		res[3].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		BLOCKMOD::Network readNetwork;
+		timer.start();
+		readNetwork.readXML(fname);
+		res[4].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		BLOCKMOD::Network parallelNetwork;
+		timer.start();
+		parallelNetwork.readXMLParallel(fname);
+		res[5].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		timer.start();
+		network.writeBinary(binaryFname);
+		res[6].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		BLOCKMOD::Network binaryNetwork;
+		timer.start();
+		binaryNetwork.readBinary(binaryFname);
+		res[7].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		int conCount = (int)readNetwork.m_connectors.size();
+		for (int i=0; i<BENCH_COUNT; ++i)
+			res[i].m_connectors = conCount;
+
+		if (!withScene)
+			continue;
+
+		BLOCKMOD::SceneManager sceneManager;
+		timer.start();
+		sceneManager.setNetwork(std::move(readNetwork));
+		res[8].m_times.append(timer.nsecsElapsed()*1e-6);
+
+		// time until the scene is interactive, i.e. only the first chunk of items is created
+		{
+			BLOCKMOD::SceneManager incrementalSceneManager;
+			timer.start();
+			incrementalSceneManager.setNetworkIncremental(std::move(binaryNetwork));
+			res[9].m_times.append(timer.nsecsElapsed()*1e-6);
+			incrementalSceneManager.finishPopulation();
+		}
+
+		// render the entire network into a fixed-size image, i.e. zoomed out (level of detail < 1 for large networks)
+		{
+			QImage img(1024, 1024, QImage::Format_ARGB32_Premultiplied);
+			img.fill(Qt::white);
+			QPainter painter(&img);
+			timer.start();
+			sceneManager.render(&painter, QRectF(img.rect()), sceneManager.itemsBoundingRect());
+			res[12].m_times.append(timer.nsecsElapsed()*1e-6);
+		}
+
+		// scripted drag: move a block in the middle of the network back and forth in grid steps,
+		// each step goes through BlockItem::itemChange() and SceneManager::blockMoved()
+		{
+			const BLOCKMOD::Network & n = sceneManager.network();
+			const BLOCKMOD::Block & b = n.m_blocks[(unsigned int)n.m_blocks.size()/2];
+			// const-cast is ok here, we emulate the interactive move of the item
+			BLOCKMOD::BlockItem * item = const_cast<BLOCKMOD::BlockItem *>(sceneManager.blockItemByName(b.m_name));
+			Q_ASSERT(item != nullptr);
+			QPointF startPos = item->pos();
+			timer.start();
+			for (int s=0; s<dragSteps; ++s) {
+				double dx = ((s/10) % 2 == 0) ? BLOCKMOD::Globals::GridSpacing : -BLOCKMOD::Globals::GridSpacing;
+				item->setPos(item->pos() + QPointF(dx, BLOCKMOD::Globals::GridSpacing));
+			}
+			res[10].m_times.append(timer.nsecsElapsed()*1e-6);
+			item->setPos(startPos);
+
+			// snapshot after each drag step: only the first snapshot copies the entire network
+			sceneManager.snapshot();
+			timer.start();
+			for (int s=0; s<dragSteps; ++s) {
+				double dx = ((s/10) % 2 == 0) ? BLOCKMOD::Globals::GridSpacing : -BLOCKMOD::Globals::GridSpacing;
+				item->setPos(item->pos() + QPointF(dx, BLOCKMOD::Globals::GridSpacing));
+				BLOCKMOD::NetworkSnapshot snapshot = sceneManager.snapshot();
+				Q_UNUSED(snapshot);
+			}
+			res[13].m_times.append(timer.nsecsElapsed()*1e-6);
+			item->setPos(startPos);
+		}
+
+		// remove blocks from the middle of the network
+		{
+			int count = std::min(removeCount, (int)sceneManager.network().m_blocks.size());
+			timer.start();
+			for (int i=0; i<count; ++i)
+				sceneManager.removeBlock((unsigned int)sceneManager.network().m_blocks.size()/2);
+			res[11].m_times.append(timer.nsecsElapsed()*1e-6);
+		}
+	}
+	QFile::remove(fname);
+	QFile::remove(binaryFname);
+	results.append(res);
+}
+
+
+/*! Returns median of given values. */
+double median(QList<double> values) {
+	if (values.isEmpty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	int n = values.count();
+	if (n % 2 == 1)
+		return values[n/2];
+	return 0.5*(values[n/2-1] + values[n/2]);
+}
+
+
+void writeJson(const QList<BenchResult> & results, QTextStream & out) {
+	QJsonArray arr;
+	for (const BenchResult & r : results) {
+		QJsonObject o;
+		o["benchmark"] = r.m_name;
+		o["blocks"] = r.m_params.m_blocks;
+		o["sockets"] = r.m_params.m_sockets;
+		o["fanout"] = r.m_params.m_fanOut;
+		o["segments"] = r.m_params.m_segments;
+		o["connectors"] = r.m_connectors;
+		o["repeat"] = r.m_times.count();
+		o["min_ms"] = *std::min_element(r.m_times.begin(), r.m_times.end());
+		o["median_ms"] = median(r.m_times);
+		o["max_ms"] = *std::max_element(r.m_times.begin(), r.m_times.end());
+		QJsonArray times;
+		for (double t : r.m_times)
+			times.append(t);
+		o["times_ms"] = times;
+		arr.append(o);
+	}
+	QJsonObject root;
+	root["results"] = arr;
+	out << QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+
+void writeCsv(const QList<BenchResult> & results, QTextStream & out) {
+	out << "benchmark,blocks,sockets,fanout,segments,connectors,repeat,min_ms,median_ms,max_ms\n";
+	for (const BenchResult & r : results) {
+		out << r.m_name << ","
+			<< r.m_params.m_blocks << ","
+			<< r.m_params.m_sockets << ","
+			<< r.m_params.m_fanOut << ","
+			<< r.m_params.m_segments << ","
+			<< r.m_connectors << ","
+			<< r.m_times.count() << ","
+			<< *std::min_element(r.m_times.begin(), r.m_times.end()) << ","
+			<< median(r.m_times) << ","
+			<< *std::max_element(r.m_times.begin(), r.m_times.end()) << "\n";
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+	// benchmark does not show any windows, so run without display unless requested otherwise
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication a(argc, argv);
+	QApplication::setApplicationName("BlockModBench");
+
+	// *** Locale setup for Unix/Linux ***
+#if defined(Q_OS_UNIX)
+	setlocale(LC_NUMERIC,"C");
+#endif
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Benchmarks BlockMod network and scene operations on generated networks.");
+	parser.addHelpOption();
+	QCommandLineOption blocksOpt("blocks", "Comma-separated list of network sizes (number of blocks).", "list", "100,1000,10000");
+	QCommandLineOption socketsOpt("sockets", "Number of outlet sockets per block.", "n", "2");
+	QCommandLineOption fanOutOpt("fanout", "Number of connectors per outlet socket.", "n", "1");
+	QCommandLineOption segmentsOpt("segments", "Number of segments per connector.", "n", "3");
+	QCommandLineOption repeatOpt("repeat", "Number of repetitions per benchmark.", "n", "3");
+	QCommandLineOption dragOpt("drag-steps", "Number of grid steps in scripted drag benchmark.", "n", "50");
+	QCommandLineOption removeOpt("remove", "Number of blocks removed in removeBlock benchmark.", "n", "10");
+	QCommandLineOption noSceneOpt("no-scene", "Skip scene benchmarks (setNetwork, setNetworkIncremental, drag, removeBlock, renderZoomedOut, snapshot).");
+	QCommandLineOption formatOpt("format", "Output format, either 'json' or 'csv'.", "format", "json");
+	QCommandLineOption outputOpt("output", "Output file (default: standard output).", "file");
+	parser.addOptions(QList<QCommandLineOption>() << blocksOpt << socketsOpt << fanOutOpt << segmentsOpt
+					  << repeatOpt << dragOpt << removeOpt << noSceneOpt << formatOpt << outputOpt);
+	parser.process(a);
+
+	NetworkParameters p;
+	p.m_sockets = std::max(1, parser.value(socketsOpt).toInt());
+	p.m_fanOut = std::max(1, parser.value(fanOutOpt).toInt());
+	p.m_segments = std::max(0, parser.value(segmentsOpt).toInt());
+	int repeat = std::max(1, parser.value(repeatOpt).toInt());
+	int dragSteps = std::max(0, parser.value(dragOpt).toInt());
+	int removeCount = std::max(0, parser.value(removeOpt).toInt());
+	QString format = parser.value(formatOpt);
+	if (format != "json" && format != "csv") {
+		std::cerr << "Invalid output format '" << format.toStdString() << "'" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	QTemporaryDir tmpDir;
+	if (!tmpDir.isValid()) {
+		std::cerr << "Cannot create temporary directory" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	QList<BenchResult> results;
+	try {
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+		const QStringList sizes = parser.value(blocksOpt).split(",", Qt::SkipEmptyParts);
+#else
+		const QStringList sizes = parser.value(blocksOpt).split(",", QString::SkipEmptyParts);
+#endif
+		for (const QString & s : sizes) {
+			bool ok;
+			p.m_blocks = s.trimmed().toInt(&ok);
+			if (!ok || p.m_blocks < 1) {
+				std::cerr << "Invalid network size '" << s.toStdString() << "'" << std::endl;
+				return EXIT_FAILURE;
+			}
+			std::cerr << "Benchmarking network with " << p.m_blocks << " blocks" << std::endl;
+			runBenchmarks(p, repeat, dragSteps, removeCount, !parser.isSet(noSceneOpt), tmpDir.path(), results);
+		}
+	}
+	catch (std::exception & ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// write results
+	QFile outFile;
+	if (parser.isSet(outputOpt)) {
+		outFile.setFileName(parser.value(outputOpt));
+		if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+			std::cerr << "Cannot write output file '" << outFile.fileName().toStdString() << "'" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+	}
+	QTextStream out(&outFile);
+	if (format == "json")
+		writeJson(results, out);
+	else
+		writeCsv(results, out);
+
+	// return exit code to environment
+	return EXIT_SUCCESS;
+}
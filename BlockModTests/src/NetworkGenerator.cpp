@@ -0,0 +1,56 @@
+#include "NetworkGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <BM_Globals.h>
+
+void generateNetwork(const NetworkParameters & p, BLOCKMOD::Network & network) {
+	network = BLOCKMOD::Network();
+
+	const int GX = (int)BLOCKMOD::Globals::GridSpacing;
+	const int inlets = p.m_sockets*p.m_fanOut;
+	const int columns = std::max(1, (int)std::ceil(std::sqrt((double)p.m_blocks)));
+	const int blockWidth = 10*GX;
+	const int blockHeight = 2*GX*(std::max(inlets, p.m_sockets) + 1);
+
+	network.m_blocks.reserve(p.m_blocks);
+	for (int i=0; i<p.m_blocks; ++i) {
+		BLOCKMOD::Block b;
+		b.m_name = QString("B%1").arg(i);
+		b.m_pos = QPointF((i % columns)*(blockWidth + 10*GX), (i / columns)*(blockHeight + 10*GX));
+		b.m_size = QSizeF(blockWidth, blockHeight);
+		if (i % 10 == 0)
+			b.m_properties["ShowPixmap"] = true;
+		for (int j=0; j<inlets; ++j)
+			b.m_sockets.append( BLOCKMOD::Socket(QString("in%1").arg(j), QPointF(0, 2*GX*(j+1)), Qt::Horizontal, true) );
+		for (int j=0; j<p.m_sockets; ++j)
+			b.m_sockets.append( BLOCKMOD::Socket(QString("out%1").arg(j), QPointF(blockWidth, 2*GX*(j+1)), Qt::Horizontal, false) );
+		network.m_blocks.push_back(std::move(b));
+	}
+
+	if (p.m_blocks < 2)
+		return;
+
+	network.m_connectors.reserve(p.m_blocks*p.m_sockets*p.m_fanOut);
+	for (int i=0; i<p.m_blocks; ++i) {
+		for (int j=0; j<p.m_sockets; ++j) {
+			for (int k=0; k<p.m_fanOut; ++k) {
+				int target = (i + k + 1) % p.m_blocks;
+				if (target == i)
+					continue; // fan-out larger than network, skip self-connections
+				BLOCKMOD::Connector con;
+				con.m_name = QString("C%1_%2_%3").arg(i).arg(j).arg(k);
+				con.m_sourceSocket = QString("B%1.out%2").arg(i).arg(j);
+				con.m_targetSocket = QString("B%1.in%2").arg(target).arg(j*p.m_fanOut + k);
+				// alternating segments, adjustConnector() corrects the remaining distance
+				for (int s=0; s<p.m_segments; ++s) {
+					Qt::Orientation dir = (s % 2 == 0) ? Qt::Horizontal : Qt::Vertical;
+					double offset = ((s/2) % 2 == 0) ? 2*GX : -2*GX;
+					con.m_segments.append( BLOCKMOD::Connector::Segment(dir, offset) );
+				}
+				network.m_connectors.push_back(std::move(con));
+			}
+		}
+	}
+}
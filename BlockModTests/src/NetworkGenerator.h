@@ -0,0 +1,29 @@
+#ifndef NetworkGeneratorH
+#define NetworkGeneratorH
+
+#include <BM_Network.h>
+
+/*! Parameters of a generated network. */
+struct NetworkParameters {
+	/*! Number of blocks. */
+	int		m_blocks;
+	/*! Number of outlet sockets per block. */
+	int		m_sockets;
+	/*! Number of connectors starting at each outlet socket. */
+	int		m_fanOut;
+	/*! Number of segments generated for each connector (before adjusting connectors). */
+	int		m_segments;
+};
+
+/*! Generates a network with given parameters.
+	The generator is fully deterministic, i.e. the same parameters always produce the same network.
+
+	Blocks are placed in a square grid. Each block has m_sockets outlets (right side) and m_sockets*m_fanOut
+	inlets (left side). Outlet j of block i is connected to the inlets j*fanOut + k of the blocks i+k+1 (k = 0...fanOut-1),
+	so that each inlet receives exactly one connection. Every 10th block has the "ShowPixmap" property set.
+
+	Connectors are created with flat socket names and must be adjusted afterwards.
+*/
+void generateNetwork(const NetworkParameters & p, BLOCKMOD::Network & network);
+
+#endif // NetworkGeneratorH
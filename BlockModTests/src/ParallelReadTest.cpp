@@ -0,0 +1,204 @@
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <iostream>
+
+#include <BM_Network.h>
+
+#include "NetworkGenerator.h"
+
+/*! Returns content of given file. */
+QByteArray fileContent(const QString & fname) {
+	QFile f(fname);
+	if (!f.open(QIODevice::ReadOnly))
+		return QByteArray();
+	return f.readAll();
+}
+
+
+/*! Writes data to given file. */
+bool writeFile(const QString & fname, const QByteArray & data) {
+	QFile f(fname);
+	if (!f.open(QIODevice::WriteOnly))
+		return false;
+	return f.write(data) == data.size();
+}
+
+
+/*! Reads the given file with the sequential and the parallel reader and compares the results.
+	If reading fails, both readers must fail with the same error message.
+	Returns true if results are identical.
+*/
+bool compareReaders(const QString & fname, const QString & tmpDir) {
+	BLOCKMOD::Network sequential;
+	QString sequentialError;
+	try {
+		sequential.readXML(fname);
+	}
+	catch (std::exception & ex) {
+		sequentialError = ex.what();
+	}
+
+	BLOCKMOD::Network parallel;
+	QString parallelError;
+	try {
+		parallel.readXMLParallel(fname);
+	}
+	catch (std::exception & ex) {
+		parallelError = ex.what();
+	}
+
+	if (sequentialError != parallelError) {
+		std::cerr << "  different errors:\n    sequential: " << sequentialError.toStdString()
+				  << "\n    parallel:   " << parallelError.toStdString() << std::endl;
+		return false;
+	}
+	if (!sequentialError.isEmpty())
+		return true;
+
+	// compare both the XML and the binary representation, the latter includes also the parsed number values
+	QString seqFname = tmpDir + "/sequential";
+	QString parFname = tmpDir + "/parallel";
+	sequential.writeXML(seqFname + ".bm");
+	parallel.writeXML(parFname + ".bm");
+	sequential.writeBinary(seqFname + ".bmb");
+	parallel.writeBinary(parFname + ".bmb");
+	if (fileContent(seqFname + ".bm") != fileContent(parFname + ".bm")) {
+		std::cerr << "  different XML output" << std::endl;
+		return false;
+	}
+	if (fileContent(seqFname + ".bmb") != fileContent(parFname + ".bmb")) {
+		std::cerr << "  different binary output" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+int main(int argc, char *argv[]) {
+	QCoreApplication a(argc, argv);
+
+	// *** Locale setup for Unix/Linux ***
+#if defined(Q_OS_UNIX)
+	setlocale(LC_NUMERIC,"C");
+#endif
+
+	QTemporaryDir tmpDir;
+	if (!tmpDir.isValid()) {
+		std::cerr << "Cannot create temporary directory" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// network sizes can be passed as first argument, e.g. 'ParallelReadTest 10,1000,100000'
+	QString sizeList = "10,1000,100000";
+	if (argc > 1)
+		sizeList = argv[1];
+
+	bool success = true;
+	try {
+		// generated networks
+#if QT_VERSION >= QT_VERSION_CHECK(5,14,0)
+		const QStringList sizes = sizeList.split(",", Qt::SkipEmptyParts);
+#else
+		const QStringList sizes = sizeList.split(",", QString::SkipEmptyParts);
+#endif
+		for (const QString & s : sizes) {
+			NetworkParameters p;
+			p.m_blocks = s.trimmed().toInt();
+			p.m_sockets = 2;
+			p.m_fanOut = 2;
+			p.m_segments = 3;
+			if (p.m_blocks < 1) {
+				std::cerr << "Invalid network size '" << s.toStdString() << "'" << std::endl;
+				return EXIT_FAILURE;
+			}
+			BLOCKMOD::Network network;
+			generateNetwork(p, network);
+			network.adjustConnectors();
+			QString fname = tmpDir.path() + QString("/generated_%1.bm").arg(p.m_blocks);
+			network.writeXML(fname);
+			std::cout << "Generated network with " << p.m_blocks << " blocks" << std::endl;
+			if (!compareReaders(fname, tmpDir.path()))
+				success = false;
+
+			// truncated file: both readers must report the same error
+			QByteArray data = fileContent(fname);
+			QString truncatedFname = tmpDir.path() + QString("/truncated_%1.bm").arg(p.m_blocks);
+			writeFile(truncatedFname, data.left(data.size()*2/3));
+			std::cout << "Truncated network with " << p.m_blocks << " blocks" << std::endl;
+			if (!compareReaders(truncatedFname, tmpDir.path()))
+				success = false;
+
+			// corrupted file: invalid value inside a block in the middle of the file
+			int idx = data.indexOf("<Size>", data.size()/2);
+			if (idx != -1) {
+				data.replace(idx, 7, "<Size>x");
+				QString corruptedFname = tmpDir.path() + QString("/corrupted_%1.bm").arg(p.m_blocks);
+				writeFile(corruptedFname, data);
+				std::cout << "Corrupted network with " << p.m_blocks << " blocks" << std::endl;
+				if (!compareReaders(corruptedFname, tmpDir.path()))
+					success = false;
+			}
+		}
+
+		// handcrafted file with constructs that must not confuse the section scanner
+		const char * const TRICKY_XML =
+			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<!-- <Blocks> in a comment -->\n"
+			"<BlockMod>\n"
+			"	<Blocks>\n"
+			"		<!-- <Block name=\"Commented\"> -->\n"
+			"		<Block name=\"A&gt;B\">\n"
+			"			<Position>0, 0</Position>\n"
+			"			<Size>80, 40</Size>\n"
+			"			<Sockets>\n"
+			"				<Socket name=\"out\">\n"
+			"					<Position>80, 20</Position>\n"
+			"					<Orientation>Horizontal</Orientation>\n"
+			"					<Inlet>false</Inlet>\n"
+			"				</Socket>\n"
+			"			</Sockets>\n"
+			"			<Properties>\n"
+			"				<ShowPixmap>true</ShowPixmap>\n"
+			"				<Comment><![CDATA[</Block><Block name=\"fake\">]]></Comment>\n"
+			"			</Properties>\n"
+			"		</Block>\n"
+			"		<Block name='C>D'>\n"
+			"			<Position>200, 0</Position>\n"
+			"			<Size>80, 40</Size>\n"
+			"			<Sockets>\n"
+			"				<Socket name=\"in\">\n"
+			"					<Position>0, 20</Position>\n"
+			"					<Orientation>Horizontal</Orientation>\n"
+			"					<Inlet>true</Inlet>\n"
+			"				</Socket>\n"
+			"			</Sockets>\n"
+			"		</Block>\n"
+			"	</Blocks>\n"
+			"	<Connectors>\n"
+			"		<Connector name=\"con\">\n"
+			"			<Source>A&gt;B.out</Source>\n"
+			"			<Target>C&gt;D.in</Target>\n"
+			"		</Connector>\n"
+			"	</Connectors>\n"
+			"</BlockMod>\n";
+		QString trickyFname = tmpDir.path() + "/tricky.bm";
+		writeFile(trickyFname, QByteArray(TRICKY_XML));
+		std::cout << "Handcrafted network" << std::endl;
+		if (!compareReaders(trickyFname, tmpDir.path()))
+			success = false;
+	}
+	catch (std::exception & ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!success) {
+		std::cerr << "Sequential and parallel reader results differ" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Sequential and parallel reader results are identical" << std::endl;
+	return EXIT_SUCCESS;
+}